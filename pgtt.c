@@ -10,7 +10,12 @@
  *-------------------------------------------------------------------------
  */
 #include "postgres.h"
+#include <limits.h>
+#include <math.h>
 #include <unistd.h>
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
 #include "funcapi.h"
 #include "libpq/pqformat.h"
 #include "miscadmin.h"
@@ -19,17 +24,27 @@
 #include "access/parallel.h"
 #include "access/reloptions.h"
 #include "access/sysattr.h"
+#include "access/tableam.h"
+#include "access/visibilitymap.h"
 #include "access/xact.h"
 #include "catalog/catalog.h"
+#include "catalog/dependency.h"
 #include "catalog/indexing.h"
 #include "catalog/namespace.h"
 #include "catalog/objectaccess.h"
+#include "catalog/pg_am.h"
 #include "catalog/pg_authid.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_database.h"
 #include "catalog/pg_extension.h"
+#include "catalog/pg_inherits.h"
 #include "catalog/pg_namespace.h"
+#include "catalog/heap.h"
+#include "catalog/partition.h"
 #include "catalog/pg_operator.h"
+#include "catalog/pg_sequence.h"
+#include "catalog/pg_statistic.h"
+#include "catalog/pg_tablespace.h"
 #include "catalog/pg_trigger.h"
 #include "catalog/pg_type.h"
 #include "catalog/toasting.h"
@@ -37,6 +52,8 @@
 #include "commands/defrem.h"
 #include "commands/extension.h"
 #include "commands/tablecmds.h"
+#include "commands/tablespace.h"
+#include "commands/trigger.h"
 #include "commands/comment.h"
 #include "executor/spi.h"
 #include "nodes/makefuncs.h"
@@ -45,21 +62,35 @@
 #include "nodes/pg_list.h"
 #include "nodes/print.h"
 #include "nodes/value.h"
+#include "optimizer/optimizer.h"
 #include "optimizer/paths.h"
 #include "optimizer/plancat.h"
 #include "parser/analyze.h"
+#include "parser/parse_relation.h"
+#include "parser/parse_type.h"
 #include "parser/parse_utilcmd.h"
 #include "parser/parser.h"
+#include "parser/parsetree.h"
+#include "port/pg_crc32c.h"
+#include "storage/buf_internals.h"
+#include "storage/bufmgr.h"
 #include "storage/ipc.h"
 #include "storage/lmgr.h"
 #include "storage/proc.h"
+#include "storage/procarray.h"
+#include "tcop/tcopprot.h"
 #include "tcop/utility.h"
 #include "utils/acl.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/fmgroids.h"
 #include "utils/formatting.h"
+#include "utils/guc.h"
 #include "utils/inval.h"
 #include "utils/lsyscache.h"
+#include "utils/plancache.h"
+#include "utils/portal.h"
+#include "utils/selfuncs.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
 #include "utils/varlena.h"
@@ -82,12 +113,18 @@
 #endif
 
 #define CATALOG_GLOBAL_TEMP_REL	"pg_global_temp_tables"
+#define CATALOG_GLOBAL_TEMP_STATS	"pg_global_temp_stats"
 #define Anum_pgtt_relid   1
 #define Anum_pgtt_nspname 2
 #define Anum_pgtt_relname 3
 
 PG_MODULE_MAGIC;
 
+/*
+ * The temporary tables of the GTT live in the local buffers of the session
+ * and can not be read by parallel workers, the planner never pushes their
+ * scans below a Gather node: the workers have nothing to do with the GTT.
+ */
 #define NOT_IN_PARALLEL_WORKER (ParallelWorkerNumber < 0)
 
 #if PG_VERSION_NUM >= 140000
@@ -136,9 +173,25 @@ PG_MODULE_MAGIC;
 static ProcessUtility_hook_type prev_ProcessUtility = NULL;
 static ExecutorStart_hook_type prev_ExecutorStart = NULL;
 static post_parse_analyze_hook_type prev_post_parse_analyze_hook = NULL;
+static ExecutorEnd_hook_type prev_ExecutorEnd = NULL;
+static ExecutorRun_hook_type prev_ExecutorRun = NULL;
+static get_relation_info_hook_type prev_get_relation_info = NULL;
+static set_rel_pathlist_hook_type prev_set_rel_pathlist = NULL;
+static get_relation_stats_hook_type prev_get_relation_stats = NULL;
+static get_attavgwidth_hook_type prev_get_attavgwidth = NULL;
 /* Hook to intercept CREATE GLOBAL TEMPORARY TABLE query */
 static void gtt_ProcessUtility(GTT_PROCESSUTILITY_PROTO);
 static void gtt_ExecutorStart(QueryDesc *queryDesc, int eflags);
+static void gtt_ExecutorEnd(QueryDesc *queryDesc);
+#if PG_VERSION_NUM >= 180000
+static void gtt_ExecutorRun(QueryDesc *queryDesc, ScanDirection direction,
+					uint64 count);
+#else
+static void gtt_ExecutorRun(QueryDesc *queryDesc, ScanDirection direction,
+					uint64 count, bool execute_once);
+#endif
+static bool gtt_frozen_insert(QueryDesc *queryDesc);
+static bool gtt_plan_has_volatile(Plan *plan);
 #if PG_VERSION_NUM >= 190000
 static void gtt_post_parse_analyze(ParseState *pstate, Query *query, const JumbleState *jstate);
 #else
@@ -157,6 +210,73 @@ static bool is_declared_gtt(Oid relid);
 /* Enable use of Global Temporary Table at session level */
 static bool pgtt_is_enabled = true;
 
+/* Automatic ANALYZE of the temporary tables */
+static bool pgtt_auto_analyze = true;
+static int pgtt_analyze_threshold = 500;
+static double pgtt_analyze_scale_factor = 0.1;
+
+/* Give the planner the number of rows of the temporary tables */
+static bool pgtt_exact_row_counts = true;
+
+/* Copy the statistics of the "template" table to the temporary tables */
+static bool pgtt_seed_statistics = true;
+
+/* Share the statistics of the temporary tables between sessions */
+static bool pgtt_learn_statistics = false;
+
+/* Number of samples of the moving average of the learned statistics */
+#define GTT_STATS_WINDOW	20
+
+/* Set the visibility map of the temporary tables after a bulk load */
+static bool pgtt_auto_vacuum = true;
+static int pgtt_vacuum_threshold = 1000;
+
+/* Maximum number of pages processed by a visibility map pass */
+#define GTT_VACUUM_MAX_PAGES	8192
+
+/* Write frozen the rows inserted in a temporary table created in the transaction */
+static bool pgtt_freeze_on_load = true;
+
+/* Session-local counters for the serial and identity columns */
+static bool pgtt_session_sequences = false;
+
+/* No comments and no TOAST table until the first write on the temporary tables */
+static bool pgtt_lean_instantiation = false;
+
+/* CREATE TEMPORARY TABLE and DROP TABLE of a GTT name use its temporary table */
+static bool pgtt_bind_temp_tables = false;
+
+/* Maximum number of temporary tables of GTT in the session, 0 for no limit */
+static int pgtt_max_instantiated = 0;
+
+/* Incremented at each use of a temporary table of GTT, for the LRU eviction */
+static uint64 gtt_use_clock = 0;
+
+/* Default local buffers budget of a GTT in blocks, -1 for no budget */
+static int pgtt_buffer_budget = -1;
+
+/* The memory of the local buffers freed by a cleared table can be released */
+static bool gtt_release_pending = false;
+
+/* The rows of a seeded GTT are being copied into its new temporary table */
+static bool gtt_copying_seed_rows = false;
+
+/* Limits of the buffered rows of the frozen multi-insert, same as COPY */
+#define GTT_MULTI_INSERT_TUPLES	1000
+#define GTT_MULTI_INSERT_BYTES	65535
+
+#if PG_VERSION_NUM >= 170000
+#define GTT_LOCK_HELD_BY_ME(tag, mode)	LockHeldByMe(tag, mode, false)
+#else
+#define GTT_LOCK_HELD_BY_ME(tag, mode)	LockHeldByMe(tag, mode)
+#endif
+
+#if PG_VERSION_NUM >= 160000
+#define GTT_NEW_STORAGE_SUBID(rel)	((rel)->rd_newRelfilelocatorSubid)
+#else
+#define GTT_NEW_STORAGE_SUBID(rel)	((rel)->rd_newRelfilenodeSubid)
+#endif
+
 /* Regular expression search */
 #define CREATE_GLOBAL_REGEXP "^\\s*CREATE\\s+(?:\\/\\*\\s*)?GLOBAL(?:\\s*\\*\\/)?"
 
@@ -172,17 +292,165 @@ typedef struct Gtt
 	char          relname[NAMEDATALEN];
 	bool          preserved;
 	bool          created;
-	char          *code;
+	bool          seeded;		/* rows of the "template" are the initial content */
+	char          *code;		/* only set at creation, not kept in cache */
 } Gtt;
 
+/*
+ * Entry of the cache of the GTT, the name is only stored in the key and
+ * the definition of the table stays in the registry.
+ */
 typedef struct relhashent
 {
 	char          name[NAMEDATALEN];
-	Gtt           gtt;
+	Oid           relid;
+	Oid           temp_relid;
+	bool          preserved;
+	bool          created;
+	bool          seeded;
 } GttHashEnt;
 
 static HTAB *GttHashTable = NULL;
 
+/* Number of entries removed from the cache and not reused */
+static long gtt_hash_free_entries = 0;
+
+/*
+ * Session-local counter replacing a sequence of a "template" table for the
+ * serial and identity columns of the temporary tables, looked up by the Oid
+ * of the sequence. The values are private to the session and no catalog
+ * nor WAL is involved.
+ */
+typedef struct GttSeqCounter
+{
+	Oid           seqid;		/* hash key, Oid of the sequence */
+	int64         last;			/* last value returned */
+	bool          called;		/* false until the first value */
+	int64         start;
+	int64         increment;
+	int64         minv;
+	int64         maxv;
+	bool          cycle;
+} GttSeqCounter;
+
+static HTAB *GttSeqTable = NULL;
+
+/*
+ * In memory state of the temporary tables created in this session for
+ * the Global Temporary Tables, looked up by the Oid of the temporary
+ * table. Autovacuum never processes temporary tables, so the changes
+ * done by the session are counted here to run an ANALYZE when needed.
+ */
+typedef struct GttSessionRel
+{
+	Oid           temp_relid;	/* hash key, Oid of the temporary table */
+	Oid           relid;		/* Oid of the "template" table */
+	bool          auto_analyze;	/* autovacuum_enabled of the "template" table */
+	int           analyze_threshold;	/* -1 to use the GUC value */
+	double        analyze_scale_factor;	/* -1 to use the GUC value */
+	int64         changes_since_analyze;
+	double        tuples_at_analyze;
+	bool          preserved;	/* ON COMMIT PRESERVE ROWS */
+	bool          tuples_valid;	/* the number of rows below is exact */
+	double        tuples;		/* number of rows in the temporary table */
+	bool          xact_tuples_valid;	/* same at start of the transaction */
+	double        xact_tuples;
+	bool          xact_changed;	/* rows changed in the current transaction */
+	double        prior_density;	/* learned rows per page, 0 if unknown */
+	int           prior_natts;	/* size of the arrays below */
+	int32        *prior_widths;	/* learned average width per attnum */
+	float4       *prior_ndistinct;	/* learned ndistinct per attnum */
+	int64         xact_inserted;	/* rows inserted in the current transaction */
+	int64         inserted_since_vacuum;	/* committed rows inserted since last pass */
+	bool          vm_pending;	/* a visibility map pass is needed */
+	bool          vm_used;	/* the visibility map has been set */
+	BlockNumber   vm_next_block;	/* where the next visibility map pass starts */
+	bool          ddl_pending;	/* the "template" table has been changed */
+	pg_crc32c     template_sig;	/* gtt_template_signature() at last sync */
+	bool          sync_failed;	/* the definition below could not be applied */
+	pg_crc32c     failed_sig;
+	bool          failed_with_rows;	/* retried once the table is empty */
+	double        expected_rows;	/* registry option, -1 if not set */
+	bool          lazy_toast;	/* TOAST table created at first write */
+	bool          bound;		/* created by a CREATE TEMPORARY TABLE */
+	bool          xact_bound;	/* same at start of the transaction */
+	uint64        last_used;	/* gtt_use_clock at the last use */
+	bool          xact_used;	/* used in the current transaction */
+	bool          evicted;		/* dropped in the current transaction */
+	SubTransactionId evicted_subid;	/* subtransaction of the eviction */
+	int           buffer_budget;	/* registry option in blocks, -1 if not set */
+	bool          over_budget;	/* has grown beyond its local buffers budget */
+	bool          seeded;		/* filled with the rows of the "template" */
+} GttSessionRel;
+
+/*
+ * Options of a GTT read once from the registry when its temporary table
+ * is created, see gtt_read_registry_options().
+ */
+typedef struct GttRegistryOptions
+{
+	List         *names;		/* all the options, for the session state */
+	List         *values;
+	char         *access_method;	/* NULL for default_table_access_method */
+	char         *tablespace;	/* list of tablespaces, NULL if not set */
+	bool          seeded;
+} GttRegistryOptions;
+
+/*
+ * DestReceiver of pgtt_populate(): the rows produced by the query are
+ * buffered and written to the temporary table with table_multi_insert().
+ */
+typedef struct GttPopulateState
+{
+	DestReceiver    pub;		/* publicly-known function pointers */
+	Relation        rel;		/* temporary table to fill */
+	CommandId       cid;		/* command id of the inserts */
+	int             ti_options;	/* table_multi_insert() options */
+	EState         *estate;	/* used to check constraints and insert index entries */
+	ResultRelInfo  *resultRelInfo;
+	BulkInsertState bistate;
+	TupleTableSlot *slots[GTT_MULTI_INSERT_TUPLES];
+	int             nslots;	/* number of buffered rows */
+	int             nallocated;	/* number of slots created */
+	Size            nbytes;	/* size of the buffered rows */
+	uint64          processed;	/* number of rows inserted */
+} GttPopulateState;
+
+static HTAB *GttSessionRelTable = NULL;
+
+/*
+ * Bind or unbind of a temporary table of GTT in the current transaction,
+ * the previous state is restored when its subtransaction is rolled back.
+ */
+typedef struct GttBoundChange
+{
+	Oid               temp_relid;
+	SubTransactionId  subid;
+	bool              prev;
+} GttBoundChange;
+
+/* Most recent first, allocated in TopTransactionContext */
+static List *gtt_bound_changes = NIL;
+
+/* Some "template" tables have been changed, see gtt_relcache_callback() */
+static bool gtt_ddl_pending = false;
+/* A synchronization is waiting for a temporary table to be empty */
+static bool gtt_ddl_failed = false;
+/* The seeded option of the GTT must be read again from the registry */
+static bool gtt_seeded_pending = false;
+/* The seeded option has been changed by the current transaction */
+static bool gtt_seeded_changed = false;
+/* Oid of the registry, its invalidation tells that an option has changed */
+static Oid gtt_registry_relid = InvalidOid;
+/* The temporary tables are being synchronized with their "template" */
+static bool gtt_in_ddl_sync = false;
+
+/* The temporary table is known to be empty */
+#define GTT_KNOWN_EMPTY(srel) ((srel)->tuples_valid && (srel)->tuples == 0)
+
+/* The pages of the temporary table are heap pages */
+#define GTT_IS_HEAP(rel) ((rel)->rd_rel->relam == HEAP_TABLE_AM_OID)
+
 /* Default size of the storage area for GTT but will be dynamically extended */
 #define GTT_PER_DATABASE	16
 
@@ -193,6 +461,8 @@ do { \
         hentry = (GttHashEnt *) hash_search(GttHashTable, NAME, HASH_REMOVE, NULL); \
         if (hentry == NULL) \
                 elog(DEBUG1, "trying to delete GTT entry in HTAB that does not exist"); \
+        else \
+                gtt_hash_free_entries++; \
 } while(0)
 
 #define GttHashTableLookup(NAME, GTT) \
@@ -202,7 +472,15 @@ do { \
 	hentry = (GttHashEnt *) hash_search(GttHashTable, \
 							   (NAME), HASH_FIND, NULL); \
 	if (hentry) \
-		GTT = hentry->gtt; \
+	{ \
+		GTT.relid = hentry->relid; \
+		GTT.temp_relid = hentry->temp_relid; \
+		strlcpy(GTT.relname, hentry->name, sizeof(GTT.relname)); \
+		GTT.preserved = hentry->preserved; \
+		GTT.created = hentry->created; \
+		GTT.seeded = hentry->seeded; \
+		GTT.code = NULL; \
+	} \
 } while(0)
 
 #define GttHashTableInsert(GTT, NAME) \
@@ -213,9 +491,14 @@ do { \
 								   (NAME), HASH_ENTER, &found); \
         if (found) \
                 elog(ERROR, "duplicate GTT name"); \
-        hentry->gtt = GTT; \
-        strlcpy(hentry->name, NAME, sizeof(hentry->name)); \
-	elog(DEBUG1, "Insert GTT entry in HTAB, key: %s, relid: %d, temp_relid: %d, created: %d", hentry->gtt.relname, hentry->gtt.relid, hentry->gtt.temp_relid, hentry->gtt.created); \
+        if (gtt_hash_free_entries > 0) \
+                gtt_hash_free_entries--; \
+        hentry->relid = (GTT).relid; \
+        hentry->temp_relid = (GTT).temp_relid; \
+        hentry->preserved = (GTT).preserved; \
+        hentry->created = (GTT).created; \
+        hentry->seeded = (GTT).seeded; \
+	elog(DEBUG1, "Insert GTT entry in HTAB, key: %s, relid: %d, temp_relid: %d, created: %d", hentry->name, hentry->relid, hentry->temp_relid, hentry->created); \
 } while(0)
 
 /* Function declarations */
@@ -224,14 +507,15 @@ PGDLLEXPORT void	_PG_init(void);
 PGDLLEXPORT void	_PG_fini(void);
 
 int strpos(char *hay, char *needle, int offset);
-static Oid gtt_create_table_statement(Gtt gtt);
-static void gtt_create_table_as(Gtt gtt, bool skipdata);
+static Oid gtt_create_table_statement(Gtt gtt, CreateStmt *stmt);
+static void gtt_create_table_as(Gtt gtt, const char *query, bool skipdata, IntoClause *into);
 static void gtt_unregister_global_temporary_table(const char *relname);
 void GttHashTableDeleteAll(void);
 bool EnableGttManager(void);
 Gtt GetGttByName(const char *name);
 static void gtt_load_global_temporary_tables(void);
-static Oid create_temporary_table_internal(ParseState *pstate, Oid parent_relid, bool preserved);
+static Oid create_temporary_table_internal(ParseState *pstate, Oid parent_relid, bool preserved,
+					bool in_partition_tree, bool copy_seed);
 static bool gtt_check_command(GTT_PROCESSUTILITY_PROTO);
 static bool gtt_table_exists(QueryDesc *queryDesc);
 void exitHook(int code, Datum arg);
@@ -240,17 +524,90 @@ static void gtt_rewrite_rte(ParseState *pstate, Query *query, RangeTblEntry *rte
 static void gtt_rewrite_query(ParseState *pstate, Query *query);
 static bool gtt_query_walker(Node *node, void *context);
 static void gtt_exec_utility_subcommand(Node *stmt, const char *querystring);
-static void gtt_copy_triggers(Oid parent_relid, const char *relname);
+static void gtt_copy_triggers(Oid parent_relid, Oid temp_relid, const char *relname);
 static void gtt_set_trigger_enabled(const char *relname, const char *tgname, char tgenabled);
 static void force_pgtt_namespace (void);
 #if PG_VERSION_NUM < 140000
 static bool gtt_stmt_is_rewritten(Node *parsetree);
 #endif
+static bool gtt_stmt_changes_template(Node *parsetree);
+static void gtt_instantiate(ParseState *pstate, Gtt *gtt, bool copy_seed);
+static bool gtt_relation_locked_by_me(Oid relid, LOCKMODE lockmode);
+static void gtt_unlock_relation_all(Oid relid, LOCKMODE lockmode);
 static void gtt_update_registered_table(Gtt gtt);
-int strremovestr(char *src, char *toremove);
+static void gtt_strip_with_data(char *query);
 static void gtt_unregister_gtt_not_cached(const char *relname);
 static bool gtt_tableelts_has_foreign_key(List *tableElts);
 static bool gtt_current_user_can_drop(Oid relid);
+static void gtt_register_session_rel(Relation parent_rel, Oid temp_relid,
+					bool preserved, bool tuples_valid);
+static List *gtt_count_changes(QueryDesc *queryDesc);
+static bool gtt_needs_analyze(GttSessionRel *srel);
+#if PG_VERSION_NUM >= 130000
+static void gtt_count_utility_changes(Node *parsetree, QueryCompletion *qc);
+#else
+static void gtt_count_utility_changes(Node *parsetree, void *qc);
+#endif
+static GttSessionRel *gtt_lookup_session_rv(RangeVar *rv);
+static void gtt_xact_callback(XactEvent event, void *arg);
+static void gtt_subxact_callback(SubXactEvent event, SubTransactionId mySubid,
+					SubTransactionId parentSubid, void *arg);
+static void gtt_cancel_eviction(GttSessionRel *srel);
+static void gtt_get_relation_info(PlannerInfo *root, Oid relationObjectId,
+					bool inhparent, RelOptInfo *rel);
+static void gtt_set_rel_pathlist(PlannerInfo *root, RelOptInfo *rel,
+					Index rti, RangeTblEntry *rte);
+static void gtt_analyze_session_rels(List *relids);
+static int gtt_copy_statistics(Oid src_relid, Oid dst_relid);
+static Oid gtt_learned_stats_relid(void);
+static void gtt_load_learned_statistics(GttSessionRel *srel);
+static void gtt_publish_statistics(GttSessionRel *srel, double reltuples, double relpages);
+static void gtt_learned_statistics_row(Oid relid, bool create);
+static void gtt_forget_session_rel(Oid temp_relid);
+static bool gtt_get_relation_stats(PlannerInfo *root, RangeTblEntry *rte,
+					AttrNumber attnum, VariableStatData *vardata);
+static int32 gtt_get_attavgwidth(Oid relid, AttrNumber attnum);
+static void gtt_vacuum_session_rel(Relation rel, GttSessionRel *srel);
+static void gtt_relcache_callback(Datum arg, Oid relid);
+static void gtt_sync_pending_tables(void);
+static pg_crc32c gtt_template_signature(Relation rel);
+static char *gtt_sync_session_rel(Oid relid, Oid temp_relid);
+static List *gtt_template_reloptions(Oid relid);
+static Oid gtt_registry_options_relid(void);
+static bool gtt_check_registry_option(const char *name, const char *value,
+					GttSessionRel *srel, int elevel);
+static void gtt_read_registry_options(Oid relid, GttRegistryOptions *opts);
+static void gtt_apply_registry_options(GttSessionRel *srel, GttRegistryOptions *opts);
+static void gtt_store_registry_option(Oid relid, const char *name, const char *value);
+static void gtt_set_template_logged(Oid relid, bool logged);
+static char *gtt_choose_tablespace(Oid relid, const char *rawname);
+static void gtt_create_toast_table(Oid temp_relid, List *options);
+static void gtt_create_lazy_toast(Oid temp_relid);
+static bool gtt_bind_temp_table(CreateStmt *stmt);
+static bool gtt_unbind_temp_table(Oid temp_relid);
+static void gtt_truncate_bound_table(GttSessionRel *srel);
+static void gtt_set_bound(GttSessionRel *srel, bool bound);
+static void gtt_touch_session_rel(Oid temp_relid);
+static void gtt_evict_session_rels(void);
+static int64 gtt_release_local_buffers(void);
+static void gtt_check_buffer_budget(GttSessionRel *srel);
+static HTAB *gtt_create_hash_table(long nelem);
+static void gtt_refresh_seeded(void);
+static uint64 gtt_copy_seed_rows(Oid parent_relid, Oid temp_relid);
+static void gtt_compact_hash_table(void);
+static CreateStmt *gtt_partition_template_stmt(CreateStmt *stmt, bool *preserved);
+static Oid gtt_instantiate_partition_tree(ParseState *pstate, Oid relid);
+static PartitionSpec *gtt_template_partspec(Oid relid);
+static void gtt_attach_partitions(ParseState *pstate, Oid parent_relid, Oid temp_relid);
+static void gtt_unregister_partitions(Oid relid);
+static void gtt_set_session_sequences(Oid parent_relid, const char *relname);
+
+PG_FUNCTION_INFO_V1(pgtt_capture_statistics);
+PG_FUNCTION_INFO_V1(pgtt_populate);
+PG_FUNCTION_INFO_V1(pgtt_set_option);
+PG_FUNCTION_INFO_V1(pgtt_nextval);
+PG_FUNCTION_INFO_V1(pgtt_local_buffers);
+PG_FUNCTION_INFO_V1(pgtt_release_local_buffers);
 
 /*
  * Module load callback
@@ -276,7 +633,6 @@ _PG_init(void)
 
 	/*
  	 * Define (or redefine) custom GUC variables.
-	 * No custom GUC variable at this time
 	 */
 	DefineCustomBoolVariable("pgtt.enabled",
 							"Enable use of Global Temporary Table",
@@ -291,6 +647,200 @@ _PG_init(void)
 							NULL,
 							NULL);
 
+	DefineCustomBoolVariable("pgtt.auto_analyze",
+							"Analyze the temporary tables of the GTT after enough changes",
+							"Autovacuum never processes temporary tables, when enabled "
+							"the extension runs an ANALYZE on the temporary table once "
+							"the number of rows inserted, updated or deleted exceeds "
+							"the analyze threshold.",
+							&pgtt_auto_analyze,
+							true,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("pgtt.analyze_threshold",
+							"Minimum number of changes before analyzing a GTT",
+							"Can be overridden per GTT with the autovacuum_analyze_threshold "
+							"storage parameter of the \"template\" table.",
+							&pgtt_analyze_threshold,
+							500,
+							0,
+							INT_MAX,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomRealVariable("pgtt.analyze_scale_factor",
+							"Number of changes before analyzing a GTT as a fraction of its rows",
+							"Can be overridden per GTT with the autovacuum_analyze_scale_factor "
+							"storage parameter of the \"template\" table.",
+							&pgtt_analyze_scale_factor,
+							0.1,
+							0.0,
+							100.0,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomBoolVariable("pgtt.exact_row_counts",
+							"Give the planner the exact number of rows of the GTT",
+							"The extension counts the rows inserted, deleted and truncated "
+							"in the temporary tables of the GTT, when enabled this number "
+							"replaces the planner estimate based on the number of pages.",
+							&pgtt_exact_row_counts,
+							true,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomBoolVariable("pgtt.seed_statistics",
+							"Copy the statistics of the GTT to its temporary table",
+							"When enabled the statistics stored on the \"template\" table, "
+							"by pgtt_capture_statistics() or by an ANALYZE of representative "
+							"data, are copied to the temporary table when it is created.",
+							&pgtt_seed_statistics,
+							true,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomBoolVariable("pgtt.auto_vacuum",
+							"Set the visibility map of the temporary tables of the GTT",
+							"Autovacuum never processes temporary tables, when enabled the "
+							"extension sets the visibility map of the pages loaded by a "
+							"committed transaction the next time the temporary table is "
+							"used by a query so that index-only scans avoid heap fetches.",
+							&pgtt_auto_vacuum,
+							true,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("pgtt.vacuum_threshold",
+							"Minimum number of inserted rows before setting the visibility map of a GTT",
+							NULL,
+							&pgtt_vacuum_threshold,
+							1000,
+							0,
+							INT_MAX,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomBoolVariable("pgtt.freeze_on_load",
+							"Write frozen the rows of an INSERT ... SELECT into a new temporary table of GTT",
+							"When the temporary table has been created or truncated in the "
+							"current transaction the rows of an INSERT ... SELECT are "
+							"written frozen and in batches, like COPY FREEZE.",
+							&pgtt_freeze_on_load,
+							true,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomBoolVariable("pgtt.learn_statistics",
+							"Share the statistics of the GTT between sessions",
+							"When enabled the number of rows per page, the width and the "
+							"number of distinct values of the columns found by ANALYZE on "
+							"the temporary tables are averaged in pg_global_temp_stats and "
+							"used by the planner of the new sessions until their own ANALYZE.",
+							&pgtt_learn_statistics,
+							false,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomBoolVariable("pgtt.session_sequences",
+							"Use session-local counters for the serial and identity columns of the GTT",
+							"When enabled the temporary tables created later take the values "
+							"of their serial and identity columns from a counter private to "
+							"the session instead of the shared sequence of the \"template\" "
+							"table or of a new temporary sequence.",
+							&pgtt_session_sequences,
+							false,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomBoolVariable("pgtt.bind_temp_tables",
+							"Use the GTT for the temporary tables with the same name and columns",
+							"When enabled a CREATE TEMPORARY TABLE without the GLOBAL keyword "
+							"whose name and columns match a GTT uses the temporary table of "
+							"the GTT, and a DROP TABLE of this name only truncates it.",
+							&pgtt_bind_temp_tables,
+							false,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("pgtt.max_instantiated",
+							"Maximum number of temporary tables of GTT in a session",
+							"When a GTT is used for the first time in a session that has "
+							"already reached this number of temporary tables, the least "
+							"recently used empty ones that are not used by the current "
+							"transaction are dropped. Zero means no limit.",
+							&pgtt_max_instantiated,
+							0,
+							0,
+							INT_MAX,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomIntVariable("pgtt.buffer_budget",
+							"Local buffers that a GTT can keep once it has been emptied",
+							"When the temporary table of a GTT without buffer_budget option "
+							"has grown beyond this size, the memory of the local buffers "
+							"it used is given back to the system once the table has been "
+							"emptied or dropped. -1 disables the release.",
+							&pgtt_buffer_budget,
+							-1,
+							-1,
+							INT_MAX / 2,
+							PGC_USERSET,
+							GUC_UNIT_BLOCKS,
+							NULL,
+							NULL,
+							NULL);
+
+	DefineCustomBoolVariable("pgtt.lean_instantiation",
+							"Reduce the catalog footprint of the temporary tables of the GTT",
+							"When enabled the temporary tables created later do not copy the "
+							"comments of the \"template\" table and their TOAST table is only "
+							"created by the first statement writing to them.",
+							&pgtt_lean_instantiation,
+							false,
+							PGC_USERSET,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
 	/*
 	 * Immediately try to load the extension.
 	 *
@@ -324,12 +874,30 @@ _PG_init(void)
 	 */
 	prev_ExecutorStart = ExecutorStart_hook;
 	ExecutorStart_hook = gtt_ExecutorStart;
+	prev_ExecutorEnd = ExecutorEnd_hook;
+	ExecutorEnd_hook = gtt_ExecutorEnd;
+	prev_ExecutorRun = ExecutorRun_hook;
+	ExecutorRun_hook = gtt_ExecutorRun;
 	prev_post_parse_analyze_hook = post_parse_analyze_hook;
 	post_parse_analyze_hook = gtt_post_parse_analyze;
 
 	prev_ProcessUtility = ProcessUtility_hook;
 	ProcessUtility_hook = gtt_ProcessUtility;
 
+	prev_get_relation_info = get_relation_info_hook;
+	get_relation_info_hook = gtt_get_relation_info;
+	prev_set_rel_pathlist = set_rel_pathlist_hook;
+	set_rel_pathlist_hook = gtt_set_rel_pathlist;
+	prev_get_relation_stats = get_relation_stats_hook;
+	get_relation_stats_hook = gtt_get_relation_stats;
+	prev_get_attavgwidth = get_attavgwidth_hook;
+	get_attavgwidth_hook = gtt_get_attavgwidth;
+
+	/* Track the number of rows of the temporary tables at transaction end */
+	RegisterXactCallback(gtt_xact_callback, NULL);
+	RegisterSubXactCallback(gtt_subxact_callback, NULL);
+	CacheRegisterRelcacheCallback(gtt_relcache_callback, (Datum) 0);
+
 	/* set the exit hook */
 	on_proc_exit(&exitHook, PointerGetDatum(NULL));
 }
@@ -344,8 +912,16 @@ _PG_fini(void)
 
 	/* Uninstall hooks. */
 	ExecutorStart_hook = prev_ExecutorStart;
+	ExecutorEnd_hook = prev_ExecutorEnd;
+	ExecutorRun_hook = prev_ExecutorRun;
 	post_parse_analyze_hook = prev_post_parse_analyze_hook;
 	ProcessUtility_hook = prev_ProcessUtility;
+	get_relation_info_hook = prev_get_relation_info;
+	set_rel_pathlist_hook = prev_set_rel_pathlist;
+	get_relation_stats_hook = prev_get_relation_stats;
+	get_attavgwidth_hook = prev_get_attavgwidth;
+	UnregisterXactCallback(gtt_xact_callback, NULL);
+	UnregisterSubXactCallback(gtt_subxact_callback, NULL);
 }
 
 /*
@@ -362,8 +938,12 @@ gtt_ProcessUtility(GTT_PROCESSUTILITY_PROTO)
 {
 	elog(DEBUG1, "gtt_ProcessUtility()");
 
-	/* Do not waste time here if the feature is not enabled for this session */
-	if (pgtt_is_enabled && NOT_IN_PARALLEL_WORKER)
+	/*
+	 * Do not waste time here if the feature is not enabled for this session,
+	 * the statements executed to synchronize a temporary table with its
+	 * "template" are not concerned either.
+	 */
+	if (pgtt_is_enabled && NOT_IN_PARALLEL_WORKER && !gtt_in_ddl_sync)
 	{
 		/* Try to load pgtt if not already done. */
 		gtt_try_load();
@@ -376,7 +956,7 @@ gtt_ProcessUtility(GTT_PROCESSUTILITY_PROTO)
 
 		/*
 		 * gtt_check_command() rewrites the parse tree of some statements
-		 * (SET search_path and CREATE GLOBAL TEMPORARY TABLE ... AS).
+		 * (SET search_path, CREATE GLOBAL TEMPORARY TABLE ... AS and COPY).
 		 * The tree we receive here can belong to a cached plan, in which
 		 * case it must be considered read only: it is reused as is at the
 		 * next execution of the same statement.  This is what happens for
@@ -438,6 +1018,33 @@ gtt_ProcessUtility(GTT_PROCESSUTILITY_PROTO)
 	}
 	PG_END_TRY();
 
+	/*
+	 * Maintain the number of rows of the temporary tables of GTT, even when
+	 * the extension is disabled, the temporary tables can still be modified.
+	 */
+	if (NOT_IN_PARALLEL_WORKER && GttSessionRelTable != NULL)
+	{
+#if PG_VERSION_NUM >= 130000
+		gtt_count_utility_changes(pstmt->utilityStmt, qc);
+#else
+		gtt_count_utility_changes(pstmt->utilityStmt, NULL);
+#endif
+	}
+
+	/*
+	 * Apply immediately the changes made on a "template" table to the
+	 * temporary table of the session, the next statement may use them.
+	 * The command counter is incremented to receive the invalidations.
+	 */
+	if (pgtt_is_enabled && NOT_IN_PARALLEL_WORKER && GttSessionRelTable != NULL
+			&& !gtt_in_ddl_sync
+			&& gtt_stmt_changes_template(pstmt->utilityStmt)
+			&& IsTransactionState())
+	{
+		CommandCounterIncrement();
+		gtt_sync_pending_tables();
+	}
+
 	elog(DEBUG1, "End of gtt_ProcessUtility()");
 }
 
@@ -533,6 +1140,13 @@ gtt_stmt_is_rewritten(Node *parsetree)
 		case T_VariableSetStmt:
 		/* the relation is moved to the pgtt schema and set unlogged */
 		case T_CreateTableAsStmt:
+		/* the relation is rerouted to the temporary table */
+		case T_CopyStmt:
+		case T_TruncateStmt:
+		/* the relation is rerouted to the "template" table */
+		case T_IndexStmt:
+		case T_AlterTableStmt:
+		case T_RenameStmt:
 			return true;
 		default:
 			return false;
@@ -540,6 +1154,29 @@ gtt_stmt_is_rewritten(Node *parsetree)
 }
 #endif
 
+/*
+ * Return true when the statement may change the definition of a "template"
+ * table that must be reported on the temporary tables of the session.
+ */
+static bool
+gtt_stmt_changes_template(Node *parsetree)
+{
+	if (parsetree == NULL)
+		return false;
+
+	switch (nodeTag(parsetree))
+	{
+		case T_IndexStmt:
+		case T_AlterTableStmt:
+		case T_RenameStmt:
+		case T_CreateTrigStmt:
+		case T_DropStmt:
+			return true;
+		default:
+			return false;
+	}
+}
+
 /*
  * Look at utility command to search CREATE TABLE / DROP TABLE
  * and INSERT INTO statements to see if a Global Temporary Table
@@ -623,6 +1260,7 @@ gtt_check_command(GTT_PROCESSUTILITY_PROTO)
 		{
 			Gtt gtt;
 			int i;
+			char *query;
 			CreateTableAsStmt *stmt = (CreateTableAsStmt *)parsetree;
 			bool skipdata = stmt->into->skipData;
 			bool regexec_result;
@@ -704,8 +1342,8 @@ gtt_check_command(GTT_PROCESSUTILITY_PROTO)
 			strlcpy(gtt.relname, name, sizeof(gtt.relname));
 			gtt.preserved = preserved;
 			gtt.created = false;
-			/* Extract the AS ... code part from the query */
-			gtt.code = pstrdup(queryString);
+			gtt.seeded = false;
+			/* Extract the query following the AS keyword */
 			for (i = 30; i < strlen(queryString) - 1; i++)
 			{
 				if (    isspace(queryString[i])
@@ -717,16 +1355,16 @@ gtt_check_command(GTT_PROCESSUTILITY_PROTO)
 			if (i == strlen(queryString) - 1)
 				elog(ERROR, "can not find AS keyword in this CREATE TABLE AS statement.");
 
-			gtt.code += i;
+			query = pstrdup(queryString + i + 3);
+			while (isspace((unsigned char) *query))
+				query++;
 
-			if (gtt.code[strlen(gtt.code) - 1] == ';')
-				gtt.code[strlen(gtt.code) - 1] = 0;
-
-			/* remove WITH DATA from the code */
-			strremovestr(gtt.code, "WITH DATA");
+			/* remove WITH [NO] DATA, skipData already tells what to do */
+			gtt_strip_with_data(query);
+			gtt.code = psprintf("AS %s", query);
 
 			/* Create the necessary object to emulate the GTT */
-			gtt_create_table_as(gtt, skipdata);
+			gtt_create_table_as(gtt, query, skipdata, stmt->into);
 
 			work_completed = true;
 
@@ -737,6 +1375,7 @@ gtt_check_command(GTT_PROCESSUTILITY_PROTO)
 		{
 			/* CREATE TABLE statement */
 			CreateStmt *stmt = (CreateStmt *)parsetree;
+			CreateStmt *template_stmt = NULL;
 			Gtt        gtt;
 			int        len, i, start = 0, end = 0;
 			bool regexec_result;
@@ -763,7 +1402,12 @@ gtt_check_command(GTT_PROCESSUTILITY_PROTO)
 					0, NULL);
 
 			if (!regexec_result)
+			{
+				/* A local temporary table may reuse the temporary table of a GTT */
+				if (pgtt_bind_temp_tables)
+					work_completed = gtt_bind_temp_table(stmt);
 				break;
+			}
 
 			/*
 			 * Check if there is a foreign key defined in the statement.
@@ -782,21 +1426,19 @@ gtt_check_command(GTT_PROCESSUTILITY_PROTO)
 						 errmsg("attempt to create referential integrity constraint on global temporary table")));
 
 
-#if (PG_VERSION_NUM >= 100000)
 			/*
-			 * We do not allow partitioning on GTT, not that PostgreSQL can
-			 * not do it but because we want to mimic the Oracle or other
-			 * RDBMS behavior.
+			 * The "template" table of a partitioned GTT or of a partition
+			 * of a GTT is created from the statement, the temporary tables
+			 * of the partition tree are created together at first access.
 			 */
-			if (stmt->partspec != NULL)
-				elog(ERROR, "Global Temporary Table do not support partitioning.");
-#endif
+			if (stmt->partspec != NULL || stmt->partbound != NULL)
+				template_stmt = gtt_partition_template_stmt(stmt, &preserved);
 
 			/*
 			 * What to do at commit time for global temporary relations
 			 * default is ON COMMIT PRESERVE ROWS (do nothing)
 			 */
-			if (stmt->oncommit == ONCOMMIT_DELETE_ROWS)
+			if (stmt->oncommit == ONCOMMIT_DELETE_ROWS && template_stmt == NULL)
 				preserved = false;
 
 			/*
@@ -821,6 +1463,7 @@ gtt_check_command(GTT_PROCESSUTILITY_PROTO)
 			strlcpy(gtt.relname, name, sizeof(gtt.relname));
 			gtt.preserved = preserved;
 			gtt.created = false;
+			gtt.seeded = false;
 			gtt.code = NULL;
 
 			/* Extract the definition of the table */
@@ -844,15 +1487,40 @@ gtt_check_command(GTT_PROCESSUTILITY_PROTO)
 			len = end - start;
 			if (end > 0 && start > 0)
 			{
-				gtt.code = palloc0(sizeof(char *) * (len + 1));
+				gtt.code = palloc(len + 1);
 				strncpy(gtt.code, queryString+start, len);
 				gtt.code[len] = '\0';
 			}
 
+			/* The code of a partition is its PARTITION OF clause */
+			if (stmt->partbound != NULL)
+			{
+				char *upper = asc_toupper(queryString, strlen(queryString));
+				char *p = strstr(upper, "PARTITION OF");
+
+				if (p == NULL)
+					elog(ERROR, "can not find the PARTITION OF clause of Global Temporary Table \"%s\"", gtt.relname);
+				gtt.code = pstrdup(queryString + (p - upper));
+				len = strlen(gtt.code);
+				while (len > 0 && (gtt.code[len - 1] == ';' || isspace((unsigned char) gtt.code[len - 1])))
+					gtt.code[--len] = '\0';
+			}
+
 			elog(DEBUG1, "code for Global Temporary Table \"%s\" creation is \"%s\"", gtt.relname, gtt.code);
 
+			if (stmt->accessMethod != NULL)
+				(void) gtt_check_registry_option("access_method", stmt->accessMethod, NULL, ERROR);
+			if (stmt->tablespacename != NULL)
+				(void) gtt_check_registry_option("tablespace", quote_identifier(stmt->tablespacename), NULL, ERROR);
+
 			/* Create the necessary object to emulate the GTT */
-			gtt.relid = gtt_create_table_statement(gtt);
+			gtt.relid = gtt_create_table_statement(gtt, template_stmt);
+
+			/* USING and TABLESPACE are recorded in the registry for the temporary tables */
+			if (stmt->accessMethod != NULL)
+				gtt_store_registry_option(gtt.relid, "access_method", stmt->accessMethod);
+			if (stmt->tablespacename != NULL)
+				gtt_store_registry_option(gtt.relid, "tablespace", quote_identifier(stmt->tablespacename));
 
 			/*
 			 * In case of problem during GTT creation previous function
@@ -860,6 +1528,7 @@ gtt_check_command(GTT_PROCESSUTILITY_PROTO)
 			 * Update GTT cache with table flagged as created
 			 */
 			gtt.created = false;
+			gtt.seeded = false;
 			GttHashTableDelete(gtt.relname);
 			GttHashTableInsert(gtt, gtt.relname);
 			work_completed = true;
@@ -949,6 +1618,7 @@ gtt_check_command(GTT_PROCESSUTILITY_PROTO)
 					gtt.preserved = false;
 					gtt.code = NULL;
 					gtt.created = false;
+					gtt.seeded = false;
 
 #if PG_VERSION_NUM < 150000
 					elog(DEBUG1, "looking if table %s is a cached GTT", relationNameValue->val.str);
@@ -957,7 +1627,43 @@ gtt_check_command(GTT_PROCESSUTILITY_PROTO)
 					elog(DEBUG1, "looking if table %s is a cached GTT", relationNameValue->sval);
 					GttHashTableLookup(relationNameValue->sval, gtt);
 #endif
-					if (gtt.relname[0] != '\0')
+					if (gtt.relname[0] != '\0' && pgtt_bind_temp_tables
+							&& list_length(drop->objects) == 1
+							&& (relationSchemaNameValue == NULL
+								|| strcmp(strVal(relationSchemaNameValue), "pg_temp") == 0))
+					{
+						/*
+						 * The name is used by a local temporary table bound
+						 * to the GTT, the GTT itself is dropped through its
+						 * "template" table. A local temporary table that did
+						 * not match the GTT is dropped by PostgreSQL.
+						 */
+						Oid     tempNamespace = LookupExplicitNamespace("pg_temp", true);
+						Oid     local_relid = InvalidOid;
+
+						if (OidIsValid(tempNamespace))
+							local_relid = get_relname_relid(gtt.relname, tempNamespace);
+
+						if (gtt.created && gtt_unbind_temp_table(gtt.temp_relid))
+						{
+							elog(DEBUG1, "temporary table \"%s\" unbound from its GTT", gtt.relname);
+							work_completed = true;
+						}
+						else if (OidIsValid(local_relid) && local_relid != gtt.temp_relid)
+							elog(DEBUG1, "dropping local temporary table \"%s\"", gtt.relname);
+						else
+						{
+							if (drop->missing_ok)
+								ereport(NOTICE,
+										(errmsg("table \"%s\" does not exist, skipping", gtt.relname)));
+							else
+								ereport(ERROR,
+										(errcode(ERRCODE_UNDEFINED_TABLE),
+										 errmsg("table \"%s\" does not exist", gtt.relname)));
+							work_completed = true;
+						}
+					}
+					else if (gtt.relname[0] != '\0')
 					{
 						/*
 						 * When the temporary table have been created
@@ -967,11 +1673,15 @@ gtt_check_command(GTT_PROCESSUTILITY_PROTO)
 						 */
 						if (gtt.created)
 							elog(ERROR, "can not drop a GTT that is in use.");
+						/* The partitions of the GTT are dropped with it */
+						if (get_rel_relkind(gtt.relid) == RELKIND_PARTITIONED_TABLE)
+							gtt_unregister_partitions(gtt.relid);
 						/*
 						 * Unregister the Global Temporary Table and its link to the
 						 * view stored in pg_global_temp_tables table
 						 */
 						gtt_unregister_global_temporary_table(gtt.relname);
+						gtt_learned_statistics_row(gtt.relid, false);
 
 						/* Remove the table from the hash table */
 						GttHashTableDelete(gtt.relname);
@@ -1001,6 +1711,23 @@ gtt_check_command(GTT_PROCESSUTILITY_PROTO)
 			RenameStmt *stmt = (RenameStmt *)parsetree;
 			Gtt        gtt;
 
+			/*
+			 * The columns, constraints and triggers of a GTT whose temporary
+			 * table exists are renamed on the "template" table, see the
+			 * ALTER TABLE case below.
+			 */
+			if ((stmt->renameType == OBJECT_COLUMN
+					|| stmt->renameType == OBJECT_TABCONSTRAINT
+					|| stmt->renameType == OBJECT_TRIGGER)
+					&& stmt->relation != NULL && stmt->relation->schemaname == NULL)
+			{
+				gtt.relid = 0;
+				GttHashTableLookup(stmt->relation->relname, gtt);
+				if (gtt.relid != 0 && gtt.created)
+					stmt->relation->schemaname = pstrdup(pgtt_namespace_name);
+				break;
+			}
+
 			/* We only take care of tabe renaming to update our internal storage */
 			if (stmt->renameType != OBJECT_TABLE || stmt->newname == NULL)
 				break;
@@ -1013,12 +1740,22 @@ gtt_check_command(GTT_PROCESSUTILITY_PROTO)
 			if (gtt.relid == 0)
 				break;
 
-			/* If a temporary table have already created do not allow changing name */
+			/*
+			 * When the temporary table has already been created rename it
+			 * with the "template" table, the temporary tables of the other
+			 * sessions are renamed at their next statement.
+			 */
 			if (gtt.created)
-				elog(ERROR, "a temporary table has been created and is active, can not rename the GTT table in this session.");
+			{
+				RenameStmt *tmpstmt = copyObject(stmt);
 
-			/* Rename the table and get the resulting new Oid */
-			RenameRelation(stmt);
+				tmpstmt->relation->schemaname = pstrdup(pgtt_namespace_name);
+				RenameRelation(tmpstmt);
+				tmpstmt->relation->schemaname = pstrdup("pg_temp");
+				RenameRelation(tmpstmt);
+			}
+			else
+				RenameRelation(stmt);
 
 			elog(DEBUG1, "updating registered table in %s.pg_global_temp_tables.", pgtt_namespace_name);
 			strlcpy(gtt.relname, stmt->newname, sizeof(gtt.relname));
@@ -1106,6 +1843,14 @@ gtt_check_command(GTT_PROCESSUTILITY_PROTO)
 				}
 			}
 
+			/*
+			 * Once the temporary table exists an unqualified name resolves
+			 * to it, the change must be done on the "template" table and
+			 * it will be applied to the temporary tables afterward.
+			 */
+			if (gtt.created && stmt->relation->schemaname == NULL)
+				stmt->relation->schemaname = pstrdup(pgtt_namespace_name);
+
 			break;
 		}
 
@@ -1117,10 +1862,14 @@ gtt_check_command(GTT_PROCESSUTILITY_PROTO)
 			Oid        nspid;
 			char       *nspname;
 			LOCKMODE lockmode = ShareLock;
+
+			/* Explicitly created on the temporary table or another table */
+			if (stmt->relation->schemaname != NULL)
+				break;
+
 			/*
-			 * PATCH: Support CREATE INDEX CONCURRENTLY on active GTT instances.
-			 * We use ShareUpdateExclusiveLock to avoid blocking reads/writes
-			 * on the active session's data.
+			 * Use ShareUpdateExclusiveLock with CREATE INDEX CONCURRENTLY
+			 * to avoid blocking reads/writes on the active session's data.
 			 */
 			if (stmt->concurrent)
 				lockmode = ShareUpdateExclusiveLock;
@@ -1134,55 +1883,225 @@ gtt_check_command(GTT_PROCESSUTILITY_PROTO)
 									NULL);
 
 			/*
-			 * Ensure that the global temporary table (GTT) is not currently in use.
-			 * A GTT is considered "in use" only when its corresponding local temporary
-			 * table has been created in the session.
+			 * When the temporary table of the GTT has already been created
+			 * in the session the name resolves to it, create the index on
+			 * the "template" table instead. It is built on the temporary
+			 * tables of the sessions before their next statement.
 			 */
 			nspid = get_rel_namespace(relid);
 			nspname = get_namespace_name(nspid);
 			if (is_declared_gtt(relid))
 			{
-				if (strcmp(nspname, pgtt_namespace_name) != 0)
-				{
-					if (isTempNamespace(nspid))
-					{
-						if (!stmt->concurrent)
-							ereport(ERROR, (errmsg("a temporary table has been created and is active, can not add an index on the GTT table in this session.")));
-					}
-				}
+				if (strcmp(nspname, pgtt_namespace_name) != 0
+						&& isTempNamespace(nspid))
+					stmt->relation->schemaname = pstrdup(pgtt_namespace_name);
 			}
 
 			break;
 		}
 
-		default:
-			break;
-	}
-	return work_completed;
-}
-
-static void
-gtt_ExecutorStart(QueryDesc *queryDesc, int eflags)
-{
-	elog(DEBUG1, "gtt_ExecutorStart()");
+		case T_TruncateStmt:
+		{
+			/* TRUNCATE of a seeded GTT must not empty its "template" */
+			TruncateStmt *stmt = (TruncateStmt *) parsetree;
+			ListCell     *lc;
 
-	/* Do not waste time here if the feature is not enabled for this session */
-	if (pgtt_is_enabled && NOT_IN_PARALLEL_WORKER)
-	{
-		/* Try to load pgtt if not already done. */
-		gtt_try_load();
+			foreach(lc, stmt->relations)
+			{
+				RangeVar  *rv = (RangeVar *) lfirst(lc);
+				Oid        relid;
+				Gtt        gtt;
+
+				relid = RangeVarGetRelid(rv, NoLock, true);
+				if (!OidIsValid(relid) || get_rel_namespace(relid) != pgtt_namespace_oid)
+					continue;
+
+				gtt.relid = 0;
+				gtt.seeded = false;
+				GttHashTableLookup(rv->relname, gtt);
+				if (gtt.relid != relid || !gtt.seeded)
+					continue;
+
+				/* The rows of the "template" would be truncated at once */
+				gtt_instantiate(NULL, &gtt, false);
+				elog(DEBUG1, "rerouting TRUNCATE of seeded GTT table \"%s\" to temporary table with oid %d",
+							gtt.relname, gtt.temp_relid);
+				rv->schemaname = pstrdup("pg_temp");
+			}
+			break;
+		}
 
-		/* check if we are working on a GTT and create it if it doesn't exist */
-		if (queryDesc->operation == CMD_INSERT
-				|| queryDesc->operation == CMD_DELETE
-				|| queryDesc->operation == CMD_UPDATE
-				|| queryDesc->operation == CMD_SELECT)
+		case T_CopyStmt:
 		{
-			/* Verify if a GTT table is defined, create it if this is not already the case */
-			if (gtt_table_exists(queryDesc))
-				elog(DEBUG1, "ExecutorStart() statement use a Global Temporary Table");
-		}
-	}
+			/* COPY FROM/TO a GTT not already created in this session */
+			CopyStmt  *stmt = (CopyStmt *) parsetree;
+			Gtt        gtt;
+			Oid        relid;
+			Relation   rel;
+			bool       freeze;
+
+			/* COPY (query) TO is rerouted at parse analysis */
+			if (stmt->relation == NULL)
+				break;
+
+			relid = RangeVarGetRelid(stmt->relation, NoLock, true);
+			if (OidIsValid(relid) && stmt->is_from)
+				gtt_create_lazy_toast(relid);
+			if (!OidIsValid(relid) || get_rel_namespace(relid) != pgtt_namespace_oid)
+				break;
+
+			gtt.relid = 0;
+			GttHashTableLookup(stmt->relation->relname, gtt);
+			if (gtt.relid != relid)
+				break;
+
+			/* A seeded GTT is read from its "template" until it is written */
+			if (!stmt->is_from && gtt.seeded && !gtt.created)
+				break;
+
+			/*
+			 * Without this the rows would be loaded into or read from the
+			 * "template" table shared by all sessions.
+			 */
+			gtt_instantiate(NULL, &gtt, true);
+			if (stmt->is_from)
+				gtt_create_lazy_toast(gtt.temp_relid);
+
+			/*
+			 * The temporary table has just been created, as for the first
+			 * INSERT ... SELECT the rows are loaded frozen when possible.
+			 */
+			rel = table_open(gtt.temp_relid, AccessShareLock);
+			freeze = (stmt->is_from && pgtt_freeze_on_load
+						&& rel->rd_rel->relkind == RELKIND_RELATION
+						&& (rel->rd_createSubid == GetCurrentSubTransactionId()
+							|| GTT_NEW_STORAGE_SUBID(rel) == GetCurrentSubTransactionId())
+						&& ThereAreNoPriorRegisteredSnapshots()
+						&& ThereAreNoReadyPortals());
+			table_close(rel, AccessShareLock);
+
+			if (freeze)
+			{
+				ListCell *lc;
+
+				foreach(lc, stmt->options)
+				{
+					if (strcmp(((DefElem *) lfirst(lc))->defname, "freeze") == 0)
+						freeze = false;
+				}
+				if (freeze)
+					stmt->options = lappend(stmt->options,
+									makeDefElem("freeze", NULL, -1));
+			}
+#if PG_VERSION_NUM >= 140000
+			/* COPY FREEZE sets all-visible the pages it fills */
+			if (freeze && GttSessionRelTable != NULL)
+			{
+				GttSessionRel *srel;
+
+				srel = (GttSessionRel *) hash_search(GttSessionRelTable,
+										&gtt.temp_relid, HASH_FIND, NULL);
+				if (srel != NULL)
+					srel->vm_used = true;
+			}
+#endif
+
+			elog(DEBUG1, "rerouting COPY of GTT table \"%s\" to temporary table with oid %d%s",
+						gtt.relname, gtt.temp_relid, (freeze) ? " with FREEZE" : "");
+
+			stmt->relation->schemaname = pstrdup("pg_temp");
+			break;
+		}
+
+		default:
+			break;
+	}
+	return work_completed;
+}
+
+static void
+gtt_ExecutorStart(QueryDesc *queryDesc, int eflags)
+{
+	elog(DEBUG1, "gtt_ExecutorStart()");
+
+	/*
+	 * Do not waste time here if the feature is not enabled for this session,
+	 * the temporary table being seeded is not flagged as created yet.
+	 */
+	if (pgtt_is_enabled && NOT_IN_PARALLEL_WORKER && !gtt_copying_seed_rows)
+	{
+		/* Try to load pgtt if not already done. */
+		gtt_try_load();
+
+		/* check if we are working on a GTT and create it if it doesn't exist */
+		if (queryDesc->operation == CMD_INSERT
+				|| queryDesc->operation == CMD_DELETE
+				|| queryDesc->operation == CMD_UPDATE
+				|| queryDesc->operation == CMD_SELECT)
+		{
+			/* Verify if a GTT table is defined, create it if this is not already the case */
+			if (gtt_table_exists(queryDesc))
+				elog(DEBUG1, "ExecutorStart() statement use a Global Temporary Table");
+		}
+	}
+
+	/* The rows written may need the TOAST table not created with the temporary table */
+	if (NOT_IN_PARALLEL_WORKER && GttSessionRelTable != NULL
+			&& queryDesc->plannedstmt != NULL)
+	{
+		ListCell   *lc;
+
+		/* Nothing is written with a simple EXPLAIN */
+		if (!(eflags & EXEC_FLAG_EXPLAIN_ONLY))
+		{
+			foreach(lc, queryDesc->plannedstmt->resultRelations)
+			{
+				RangeTblEntry *rte = rt_fetch(lfirst_int(lc), queryDesc->plannedstmt->rtable);
+
+				gtt_create_lazy_toast(rte->relid);
+			}
+		}
+
+		/*
+		 * Set the visibility map of the rows loaded by the previous
+		 * transactions, the planner only adjusts the estimates.
+		 */
+		if (pgtt_is_enabled && pgtt_auto_vacuum && !(eflags & EXEC_FLAG_EXPLAIN_ONLY))
+		{
+			foreach(lc, queryDesc->plannedstmt->rtable)
+			{
+				RangeTblEntry *rte = (RangeTblEntry *) lfirst(lc);
+				GttSessionRel *srel;
+				Relation       rel;
+
+				if (rte->rtekind != RTE_RELATION)
+					continue;
+				srel = (GttSessionRel *) hash_search(GttSessionRelTable,
+												&rte->relid, HASH_FIND, NULL);
+				if (srel == NULL || !srel->vm_pending || srel->evicted)
+					continue;
+
+				/* already locked by the statement */
+				rel = table_open(rte->relid, AccessShareLock);
+				/* stale entry of a temporary table dropped by hand */
+				if (rel->rd_rel->relpersistence == RELPERSISTENCE_TEMP && GTT_IS_HEAP(rel))
+					gtt_vacuum_session_rel(rel, srel);
+				table_close(rel, NoLock);
+			}
+		}
+
+		/* A cached plan is not analyzed again, its tables are used here */
+		if (pgtt_max_instantiated > 0)
+		{
+			foreach(lc, queryDesc->plannedstmt->rtable)
+			{
+				RangeTblEntry *rte = (RangeTblEntry *) lfirst(lc);
+
+				if (rte->rtekind == RTE_RELATION)
+					gtt_touch_session_rel(rte->relid);
+			}
+		}
+	}
 
 	elog(DEBUG1, "restore ExecutorStart()");
 
@@ -1195,850 +2114,5116 @@ gtt_ExecutorStart(QueryDesc *queryDesc, int eflags)
 	elog(DEBUG1, "End of gtt_ExecutorStart()");
 }
 
+static void
+#if PG_VERSION_NUM >= 180000
+gtt_ExecutorRun(QueryDesc *queryDesc, ScanDirection direction, uint64 count)
+#else
+gtt_ExecutorRun(QueryDesc *queryDesc, ScanDirection direction, uint64 count,
+					bool execute_once)
+#endif
+{
+	/*
+	 * An INSERT ... SELECT into a temporary table of GTT created in the
+	 * current transaction is executed by the bulk load path.
+	 */
+	if (pgtt_freeze_on_load && NOT_IN_PARALLEL_WORKER
+			&& GttSessionRelTable != NULL && queryDesc->operation == CMD_INSERT
+			&& ScanDirectionIsForward(direction) && count == 0
+			&& gtt_frozen_insert(queryDesc))
+		return;
+
+	/* Continue the normal behavior */
+	if (prev_ExecutorRun)
+#if PG_VERSION_NUM >= 180000
+		prev_ExecutorRun(queryDesc, direction, count);
+	else
+		standard_ExecutorRun(queryDesc, direction, count);
+#else
+		prev_ExecutorRun(queryDesc, direction, count, execute_once);
+	else
+		standard_ExecutorRun(queryDesc, direction, count, execute_once);
+#endif
+}
+
+static void
+gtt_ExecutorEnd(QueryDesc *queryDesc)
+{
+	List    *analyze_relids = NIL;
+
+	elog(DEBUG1, "gtt_ExecutorEnd()");
+
+	/*
+	 * Count the changes done on the temporary tables of the GTT, even when
+	 * the extension is disabled the planner relies on the number of rows.
+	 */
+	if (NOT_IN_PARALLEL_WORKER && GttSessionRelTable != NULL)
+		analyze_relids = gtt_count_changes(queryDesc);
+
+	/* Continue the normal behavior */
+	if (prev_ExecutorEnd)
+		prev_ExecutorEnd(queryDesc);
+	else
+		standard_ExecutorEnd(queryDesc);
+
+	/*
+	 * The executor resources are released, analyze the temporary tables
+	 * that have received enough changes so that the next queries will
+	 * be planned with statistics.
+	 */
+	if (analyze_relids != NIL)
+		gtt_analyze_session_rels(analyze_relids);
+
+	elog(DEBUG1, "End of gtt_ExecutorEnd()");
+}
+
+/*
+ * Add the number of rows processed by an INSERT, UPDATE or DELETE to the
+ * changes counter of the temporary tables of GTT it has modified and
+ * maintain the number of rows they hold. Returns the list of Oid of the
+ * temporary tables that must be analyzed.
+ *
+ * The number of rows stays exact only when es_processed can be attributed
+ * to a single temporary table: a plain INSERT or DELETE on one result
+ * relation without data-modifying CTE. UPDATE does not change it. In
+ * all other cases (MERGE, INSERT ... ON CONFLICT DO UPDATE, inheritance
+ * children, ...) the number of rows is flagged unknown until the next
+ * TRUNCATE or end of transaction of an ON COMMIT DELETE ROWS table.
+ */
+static List *
+gtt_count_changes(QueryDesc *queryDesc)
+{
+	PlannedStmt   *pstmt = queryDesc->plannedstmt;
+	EState        *estate = queryDesc->estate;
+	List          *relids = NIL;
+	ListCell      *lc;
+	bool           exact_count;
+
+	if (pstmt == NULL || estate == NULL || pstmt->resultRelations == NIL)
+		return NIL;
+
+	/* Nothing has been executed with a simple EXPLAIN */
+	if (estate->es_top_eflags & EXEC_FLAG_EXPLAIN_ONLY)
+		return NIL;
+
+	if (queryDesc->operation != CMD_INSERT
+			&& queryDesc->operation != CMD_UPDATE
+#if PG_VERSION_NUM >= 150000
+			&& queryDesc->operation != CMD_MERGE
+#endif
+			&& queryDesc->operation != CMD_DELETE)
+		return NIL;
+
+	exact_count = (pstmt->canSetTag && !pstmt->hasModifyingCTE
+					&& list_length(pstmt->resultRelations) == 1
+					&& pstmt->planTree != NULL
+					&& IsA(pstmt->planTree, ModifyTable));
+	if (exact_count && queryDesc->operation == CMD_INSERT
+			&& ((ModifyTable *) pstmt->planTree)->onConflictAction == ONCONFLICT_UPDATE)
+		exact_count = false;
+
+	foreach(lc, pstmt->resultRelations)
+	{
+		RangeTblEntry *rte = rt_fetch(lfirst_int(lc), pstmt->rtable);
+		GttSessionRel *srel;
+		bool           was_empty;
+
+		srel = (GttSessionRel *) hash_search(GttSessionRelTable,
+										&rte->relid, HASH_FIND, NULL);
+		if (srel == NULL)
+			continue;
+
+		was_empty = GTT_KNOWN_EMPTY(srel);
+		srel->changes_since_analyze += estate->es_processed;
+		srel->xact_changed = true;
+
+		if (!exact_count)
+			srel->tuples_valid = false;
+		else if (queryDesc->operation == CMD_INSERT)
+		{
+			srel->tuples += estate->es_processed;
+			srel->xact_inserted += estate->es_processed;
+		}
+		else if (queryDesc->operation == CMD_DELETE)
+			srel->tuples = Max(srel->tuples - estate->es_processed, 0);
+		else if (queryDesc->operation != CMD_UPDATE)
+			srel->tuples_valid = false;
+
+		/* Plans where the scans of the empty table were removed are obsolete */
+		if (was_empty && !GTT_KNOWN_EMPTY(srel))
+			CacheInvalidateRelcacheByRelid(srel->temp_relid);
+
+		elog(DEBUG1, "temporary table with Oid %d has " INT64_FORMAT " changes since last analyze",
+					srel->temp_relid, srel->changes_since_analyze);
+
+		if (!srel->over_budget && queryDesc->operation != CMD_DELETE)
+			gtt_check_buffer_budget(srel);
+
+		if (pgtt_is_enabled && gtt_needs_analyze(srel))
+			relids = list_append_unique_oid(relids, srel->temp_relid);
+	}
+
+	return relids;
+}
+
+/*
+ * Write to the temporary table the rows buffered by gtt_frozen_insert()
+ * or pgtt_populate() and insert their index entries.
+ */
+static void
+gtt_flush_multi_insert(ResultRelInfo *resultRelInfo, EState *estate,
+					TupleTableSlot **slots, int nslots, CommandId cid,
+					int ti_options, BulkInsertState bistate)
+{
+	int i;
+
+	table_multi_insert(resultRelInfo->ri_RelationDesc, slots, nslots,
+					cid, ti_options, bistate);
+
+	for (i = 0; i < nslots; i++)
+	{
+		if (resultRelInfo->ri_NumIndices > 0)
+		{
+			List *recheck;
+
+#if PG_VERSION_NUM >= 160000
+			recheck = ExecInsertIndexTuples(resultRelInfo, slots[i], estate,
+								false, false, NULL, NIL, false);
+#elif PG_VERSION_NUM >= 140000
+			recheck = ExecInsertIndexTuples(resultRelInfo, slots[i], estate,
+								false, false, NULL, NIL);
+#else
+			recheck = ExecInsertIndexTuples(slots[i], estate, false, NULL, NIL);
+#endif
+			list_free(recheck);
+		}
+		ExecClearTuple(slots[i]);
+	}
+}
+
+/*
+ * Return true if a node of the plan tree may call a volatile function
+ * other than nextval(), as for the multi-insert of COPY. The plans of the
+ * sub-queries and CTE are not part of the tree, they are checked by the
+ * caller. Node types not known here are considered volatile.
+ */
 static bool
-gtt_table_exists(QueryDesc *queryDesc)
+gtt_plan_has_volatile(Plan *plan)
 {
-	bool    is_gtt = false;
-	char    *name = NULL;
-	char    relpersistence;
-	RangeTblEntry *rte;
-	Relation      rel;
-	Gtt           gtt;
-	PlannedStmt *pstmt = (PlannedStmt *) queryDesc->plannedstmt;
+	ListCell   *lc;
+	List       *children = NIL;
+	Node       *exprs = NULL;
+
+	if (plan == NULL)
+		return false;
+
+	if (contain_volatile_functions_not_nextval((Node *) plan->targetlist)
+			|| contain_volatile_functions_not_nextval((Node *) plan->qual))
+		return true;
+
+	switch (nodeTag(plan))
+	{
+		case T_Result:
+			exprs = ((Result *) plan)->resconstantqual;
+			break;
+		case T_ProjectSet:
+		case T_SeqScan:
+		case T_Material:
+		case T_Sort:
+#if PG_VERSION_NUM >= 130000
+		case T_IncrementalSort:
+#endif
+		case T_Unique:
+		case T_Group:
+		case T_Agg:
+		case T_Hash:
+			break;
+		case T_IndexScan:
+			exprs = (Node *) list_make2(((IndexScan *) plan)->indexqual,
+									((IndexScan *) plan)->indexorderby);
+			break;
+		case T_IndexOnlyScan:
+			exprs = (Node *) list_make2(((IndexOnlyScan *) plan)->indexqual,
+									((IndexOnlyScan *) plan)->indexorderby);
+			break;
+		case T_BitmapIndexScan:
+			exprs = (Node *) ((BitmapIndexScan *) plan)->indexqual;
+			break;
+		case T_BitmapHeapScan:
+			exprs = (Node *) ((BitmapHeapScan *) plan)->bitmapqualorig;
+			break;
+		case T_BitmapAnd:
+			children = ((BitmapAnd *) plan)->bitmapplans;
+			break;
+		case T_BitmapOr:
+			children = ((BitmapOr *) plan)->bitmapplans;
+			break;
+		case T_FunctionScan:
+			exprs = (Node *) ((FunctionScan *) plan)->functions;
+			break;
+		case T_ValuesScan:
+			exprs = (Node *) ((ValuesScan *) plan)->values_lists;
+			break;
+		case T_CteScan:
+			break;
+		case T_SubqueryScan:
+			children = list_make1(((SubqueryScan *) plan)->subplan);
+			break;
+		case T_Append:
+			children = ((Append *) plan)->appendplans;
+			break;
+		case T_MergeAppend:
+			children = ((MergeAppend *) plan)->mergeplans;
+			break;
+		case T_NestLoop:
+		case T_MergeJoin:
+		case T_HashJoin:
+			exprs = (Node *) ((Join *) plan)->joinqual;
+			break;
+		case T_Limit:
+			exprs = (Node *) list_make2(((Limit *) plan)->limitOffset,
+									((Limit *) plan)->limitCount);
+			break;
+		case T_WindowAgg:
+			exprs = (Node *) list_make2(((WindowAgg *) plan)->startOffset,
+									((WindowAgg *) plan)->endOffset);
+			break;
+		default:
+			return true;
+	}
+
+	if (contain_volatile_functions_not_nextval(exprs))
+		return true;
+
+	foreach(lc, children)
+	{
+		if (gtt_plan_has_volatile((Plan *) lfirst(lc)))
+			return true;
+	}
+
+	return gtt_plan_has_volatile(plan->lefttree)
+			|| gtt_plan_has_volatile(plan->righttree);
+}
+
+/*
+ * Bulk load path of INSERT ... SELECT into a temporary table of GTT that
+ * has been created, or truncated, in the current subtransaction, which is
+ * the case of the first INSERT into a GTT in a session: as with COPY
+ * FREEZE the rows can be written frozen, no hint bit will have to be set
+ * later, and in batches with table_multi_insert(). The subplan of the
+ * ModifyTable node is executed here instead of the node itself, so this
+ * is only done when the node has nothing else to do than inserting the
+ * rows: no trigger, RETURNING, ON CONFLICT, WITH CHECK OPTION, generated
+ * column, partition or EXPLAIN ANALYZE, and when the rows can not be seen
+ * by another snapshot of the transaction, by the query itself or by a
+ * volatile function. Returns false if the query must be executed normally.
+ */
+static bool
+gtt_frozen_insert(QueryDesc *queryDesc)
+{
+	PlannedStmt      *pstmt = queryDesc->plannedstmt;
+	EState           *estate = queryDesc->estate;
+	ModifyTableState *mtstate;
+	ModifyTable      *node;
+	ResultRelInfo    *resultRelInfo;
+	PlanState        *subplanstate;
+	Relation          rel;
+	RangeTblEntry    *rte;
+	GttSessionRel    *srel;
+	ListCell         *lc;
+	TupleTableSlot   *slots[GTT_MULTI_INSERT_TUPLES];
+	BulkInsertState   bistate;
+	MemoryContext     oldcontext;
+	int               nslots = 0;
+	int               nallocated = 0;
+	Size              nbytes = 0;
+	uint64            nprocessed = 0;
+
+	if (pstmt == NULL || estate == NULL || !pstmt->canSetTag
+			|| pstmt->hasModifyingCTE || pstmt->parallelModeNeeded
+			|| list_length(pstmt->resultRelations) != 1
+			|| queryDesc->instrument_options != 0
+			|| (estate->es_top_eflags & EXEC_FLAG_EXPLAIN_ONLY)
+			|| estate->es_processed != 0
+			|| queryDesc->planstate == NULL
+			|| !IsA(queryDesc->planstate, ModifyTableState))
+		return false;
+
+	rte = rt_fetch(linitial_int(pstmt->resultRelations), pstmt->rtable);
+	srel = (GttSessionRel *) hash_search(GttSessionRelTable,
+									&rte->relid, HASH_FIND, NULL);
+	if (srel == NULL)
+		return false;
+
+	/* The rows would be seen by the scans of the table in the query */
+	foreach(lc, pstmt->rtable)
+	{
+		RangeTblEntry *other = (RangeTblEntry *) lfirst(lc);
+
+		if (other != rte && other->rtekind == RTE_RELATION
+				&& other->relid == rte->relid)
+			return false;
+	}
+
+	mtstate = (ModifyTableState *) queryDesc->planstate;
+	node = (ModifyTable *) mtstate->ps.plan;
+	resultRelInfo = mtstate->resultRelInfo;
+	rel = resultRelInfo->ri_RelationDesc;
+#if PG_VERSION_NUM >= 140000
+	subplanstate = outerPlanState(mtstate);
+#else
+	if (mtstate->mt_nplans != 1)
+		return false;
+	subplanstate = mtstate->mt_plans[0];
+#endif
+
+	if (node->onConflictAction != ONCONFLICT_NONE
+			|| node->returningLists != NIL
+			|| node->withCheckOptionLists != NIL
+			|| resultRelInfo->ri_TrigDesc != NULL
+			|| resultRelInfo->ri_FdwRoutine != NULL
+			|| rel->rd_rel->relkind != RELKIND_RELATION
+			|| rel->rd_rel->relam != HEAP_TABLE_AM_OID
+			|| rel->rd_rel->relispartition
+			|| RelationGetRelid(rel) != rte->relid)
+		return false;
+
+	if (rel->rd_att->constr != NULL && rel->rd_att->constr->has_generated_stored)
+		return false;
+
+	/* The rows produced by the subplan must be the rows of the table */
+	if (list_length(subplanstate->plan->targetlist) != RelationGetDescr(rel)->natts)
+		return false;
+	foreach(lc, subplanstate->plan->targetlist)
+	{
+		if (((TargetEntry *) lfirst(lc))->resjunk)
+			return false;
+	}
+
+	/* Same conditions as COPY FREEZE */
+	if (rel->rd_createSubid != GetCurrentSubTransactionId()
+			&& GTT_NEW_STORAGE_SUBID(rel) != GetCurrentSubTransactionId())
+		return false;
+	if (!ThereAreNoPriorRegisteredSnapshots() || !ThereAreNoReadyPortals())
+		return false;
+
+	/*
+	 * A volatile function could look at the table while rows are buffered
+	 * and not yet written, the query is then executed normally.
+	 */
+	if (gtt_plan_has_volatile(subplanstate->plan))
+		return false;
+	foreach(lc, pstmt->subplans)
+	{
+		if (gtt_plan_has_volatile((Plan *) lfirst(lc)))
+			return false;
+	}
+
+	elog(DEBUG1, "frozen multi-insert into temporary table with Oid %d",
+				RelationGetRelid(rel));
+
+#if PG_VERSION_NUM < 180000
+	queryDesc->already_executed = true;
+#endif
+	oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+
+	if (queryDesc->totaltime)
+		InstrStartNode(queryDesc->totaltime);
+
+	if (rel->rd_rel->relhasindex && resultRelInfo->ri_IndexRelationDescs == NULL)
+		ExecOpenIndices(resultRelInfo, false);
+#if PG_VERSION_NUM < 140000
+	estate->es_result_relation_info = resultRelInfo;
+#endif
+
+	bistate = GetBulkInsertState();
+
+	for (;;)
+	{
+		TupleTableSlot *planSlot;
+		TupleTableSlot *slot;
+
+		CHECK_FOR_INTERRUPTS();
+
+		ResetPerTupleExprContext(estate);
+
+		planSlot = ExecProcNode(subplanstate);
+		if (TupIsNull(planSlot))
+			break;
+
+		/* the slots are released with the tuple table of the executor */
+		if (nslots == nallocated)
+			slots[nallocated++] = table_slot_create(rel, &estate->es_tupleTable);
+		slot = ExecCopySlot(slots[nslots], planSlot);
+
+		if (rel->rd_att->constr != NULL)
+			ExecConstraints(resultRelInfo, slot, estate);
+
+		nbytes += ExecFetchSlotHeapTuple(slot, false, NULL)->t_len;
+		nslots++;
+		nprocessed++;
+
+		if (nslots == GTT_MULTI_INSERT_TUPLES || nbytes >= GTT_MULTI_INSERT_BYTES)
+		{
+			gtt_flush_multi_insert(resultRelInfo, estate, slots, nslots,
+								estate->es_output_cid,
+								TABLE_INSERT_SKIP_FSM | TABLE_INSERT_FROZEN, bistate);
+			nslots = 0;
+			nbytes = 0;
+		}
+	}
+
+	if (nslots > 0)
+		gtt_flush_multi_insert(resultRelInfo, estate, slots, nslots,
+							estate->es_output_cid,
+							TABLE_INSERT_SKIP_FSM | TABLE_INSERT_FROZEN, bistate);
+
+	FreeBulkInsertState(bistate);
+
+	estate->es_processed += nprocessed;
+
+#if PG_VERSION_NUM >= 140000
+	/* heap_multi_insert() sets all-visible the pages it fills with frozen rows */
+	if (nprocessed > 0)
+		srel->vm_used = true;
+#endif
+
+	if (queryDesc->totaltime)
+		InstrStopNode(queryDesc->totaltime, nprocessed);
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return true;
+}
+
+/*
+ * Look for the session state of the temporary table designated by a
+ * RangeVar, returns NULL if this is not the temporary table of a GTT.
+ */
+static GttSessionRel *
+gtt_lookup_session_rv(RangeVar *rv)
+{
+	Oid relid = RangeVarGetRelid(rv, NoLock, true);
+
+	if (!OidIsValid(relid))
+		return NULL;
+
+	return (GttSessionRel *) hash_search(GttSessionRelTable,
+									&relid, HASH_FIND, NULL);
+}
+
+/*
+ * Maintain the number of rows of the temporary tables of GTT after a
+ * TRUNCATE, the table is empty, or a COPY FROM, the number of rows loaded
+ * is only reported to us since PostgreSQL 13.
+ */
+static void
+#if PG_VERSION_NUM >= 130000
+gtt_count_utility_changes(Node *parsetree, QueryCompletion *qc)
+#else
+gtt_count_utility_changes(Node *parsetree, void *qc)
+#endif
+{
+	GttSessionRel *srel;
+	ListCell      *lc;
+	bool           was_empty;
+
+	if (parsetree == NULL)
+		return;
+
+	switch (nodeTag(parsetree))
+	{
+		case T_TruncateStmt:
+		{
+			TruncateStmt *stmt = (TruncateStmt *) parsetree;
+
+			foreach(lc, stmt->relations)
+			{
+				srel = gtt_lookup_session_rv((RangeVar *) lfirst(lc));
+				if (srel == NULL)
+					continue;
+
+				srel->tuples = 0;
+				srel->tuples_valid = true;
+				srel->xact_changed = true;
+				/* the new storage has no visibility map */
+				srel->xact_inserted = 0;
+				srel->inserted_since_vacuum = 0;
+				srel->vm_pending = false;
+				srel->vm_used = false;
+				srel->vm_next_block = 0;
+				if (srel->over_budget)
+				{
+					srel->over_budget = false;
+					gtt_release_pending = true;
+				}
+				elog(DEBUG1, "temporary table with Oid %d truncated", srel->temp_relid);
+			}
+			break;
+		}
+
+		case T_CopyStmt:
+		{
+			CopyStmt *stmt = (CopyStmt *) parsetree;
+
+			if (stmt->relation == NULL)
+				break;
+
+			srel = gtt_lookup_session_rv(stmt->relation);
+			if (srel == NULL)
+				break;
+
+			gtt_touch_session_rel(srel->temp_relid);
+			if (!stmt->is_from)
+				break;
+
+			was_empty = GTT_KNOWN_EMPTY(srel);
+			srel->xact_changed = true;
+#if PG_VERSION_NUM >= 130000
+			if (qc != NULL && qc->commandTag == CMDTAG_COPY)
+			{
+				srel->tuples += qc->nprocessed;
+				srel->changes_since_analyze += qc->nprocessed;
+				srel->xact_inserted += qc->nprocessed;
+			}
+			else
+#endif
+				srel->tuples_valid = false;
+
+			if (was_empty && !GTT_KNOWN_EMPTY(srel))
+				CacheInvalidateRelcacheByRelid(srel->temp_relid);
+			if (!srel->over_budget)
+				gtt_check_buffer_budget(srel);
+			break;
+		}
+
+		default:
+			break;
+	}
+}
+
+/*
+ * At commit the temporary tables ON COMMIT DELETE ROWS are emptied and the
+ * number of rows of all temporary tables becomes the reference restored
+ * if a later transaction is rolled back. At rollback the number of rows
+ * seen at the start of the transaction is restored.
+ *
+ * The invalidation of the plans where the scans of a temporary table have
+ * been removed because it was empty can not be registered once the
+ * transaction is aborted, in this case all cached plans are invalidated.
+ */
+static void
+gtt_xact_callback(XactEvent event, void *arg)
+{
+	HASH_SEQ_STATUS status;
+	GttSessionRel  *srel;
+	bool            reset_plans = false;
+
+	/* The memory has been released with the transaction */
+	if (event == XACT_EVENT_COMMIT || event == XACT_EVENT_ABORT)
+		gtt_bound_changes = NIL;
+
+	/* The seeded option changed by the transaction is back */
+	if (event == XACT_EVENT_ABORT && gtt_seeded_changed)
+		gtt_seeded_pending = true;
+	if (event == XACT_EVENT_COMMIT || event == XACT_EVENT_ABORT)
+		gtt_seeded_changed = false;
+
+	if (GttSessionRelTable == NULL)
+		return;
+
+	switch (event)
+	{
+		case XACT_EVENT_COMMIT:
+			hash_seq_init(&status, GttSessionRelTable);
+			while ((srel = (GttSessionRel *) hash_seq_search(&status)) != NULL)
+			{
+				srel->xact_used = false;
+				if (srel->over_budget && (srel->evicted || !srel->preserved))
+				{
+					srel->over_budget = false;
+					gtt_release_pending = true;
+				}
+				if (srel->evicted)
+				{
+					gtt_forget_session_rel(srel->temp_relid);
+					continue;
+				}
+				if (!srel->preserved)
+				{
+					srel->tuples = 0;
+					srel->tuples_valid = true;
+					srel->inserted_since_vacuum = 0;
+					srel->vm_pending = false;
+					srel->vm_used = false;
+					srel->vm_next_block = 0;
+				}
+				else
+				{
+					/* the rows loaded are now visible, set the visibility map */
+					srel->inserted_since_vacuum += srel->xact_inserted;
+					if (srel->inserted_since_vacuum > 0
+							&& srel->inserted_since_vacuum >= pgtt_vacuum_threshold)
+						srel->vm_pending = true;
+				}
+				srel->xact_inserted = 0;
+				srel->xact_tuples = srel->tuples;
+				srel->xact_tuples_valid = srel->tuples_valid;
+				srel->xact_changed = false;
+				srel->xact_bound = srel->bound;
+			}
+			break;
+
+		case XACT_EVENT_ABORT:
+			hash_seq_init(&status, GttSessionRelTable);
+			while ((srel = (GttSessionRel *) hash_seq_search(&status)) != NULL)
+			{
+				bool was_empty = GTT_KNOWN_EMPTY(srel);
+
+				srel->xact_inserted = 0;
+				srel->bound = srel->xact_bound;
+				srel->xact_used = false;
+				/* The temporary table dropped by the eviction is back */
+				if (srel->evicted)
+					gtt_cancel_eviction(srel);
+				if (!srel->xact_changed)
+					continue;
+				srel->tuples = srel->xact_tuples;
+				srel->tuples_valid = srel->xact_tuples_valid;
+				srel->xact_changed = false;
+				if (was_empty && !GTT_KNOWN_EMPTY(srel))
+					reset_plans = true;
+			}
+			if (reset_plans)
+				ResetPlanCache();
+			break;
+
+		default:
+			break;
+	}
+}
+
+/*
+ * The temporary table dropped by an eviction is back after a rollback,
+ * make the cache entry of its GTT point to it again.
+ */
+static void
+gtt_cancel_eviction(GttSessionRel *srel)
+{
+	HASH_SEQ_STATUS  status;
+	GttHashEnt      *hentry;
+
+	srel->evicted = false;
+	srel->evicted_subid = InvalidSubTransactionId;
+	hash_seq_init(&status, GttHashTable);
+	while ((hentry = (GttHashEnt *) hash_seq_search(&status)) != NULL)
+	{
+		if (hentry->relid != srel->relid)
+			continue;
+		hentry->created = true;
+		hentry->temp_relid = srel->temp_relid;
+		hash_seq_term(&status);
+		break;
+	}
+}
+
+/*
+ * We do not keep the number of rows per subtransaction, the rows changed
+ * in a subtransaction that is rolled back make the number of rows unknown
+ * until the end of the transaction. An eviction, bind or unbind done in a
+ * subtransaction that is rolled back is cancelled, when the subtransaction
+ * is committed it belongs to its parent.
+ */
+static void
+gtt_subxact_callback(SubXactEvent event, SubTransactionId mySubid,
+					SubTransactionId parentSubid, void *arg)
+{
+	HASH_SEQ_STATUS status;
+	GttSessionRel  *srel;
+	ListCell       *lc;
+	bool            reset_plans = false;
+
+	if (GttSessionRelTable == NULL)
+		return;
+
+	if (event == SUBXACT_EVENT_COMMIT_SUB || event == SUBXACT_EVENT_ABORT_SUB)
+	{
+		/* Most recent first, the oldest state of the subtransaction wins */
+		foreach(lc, gtt_bound_changes)
+		{
+			GttBoundChange *change = (GttBoundChange *) lfirst(lc);
+
+			if (change->subid != mySubid)
+				continue;
+			if (event == SUBXACT_EVENT_COMMIT_SUB)
+			{
+				change->subid = parentSubid;
+				continue;
+			}
+			change->subid = InvalidSubTransactionId;
+			srel = (GttSessionRel *) hash_search(GttSessionRelTable,
+											&change->temp_relid, HASH_FIND, NULL);
+			if (srel != NULL)
+				srel->bound = change->prev;
+		}
+	}
+
+	if (event == SUBXACT_EVENT_COMMIT_SUB)
+	{
+		hash_seq_init(&status, GttSessionRelTable);
+		while ((srel = (GttSessionRel *) hash_seq_search(&status)) != NULL)
+		{
+			if (srel->evicted && srel->evicted_subid == mySubid)
+				srel->evicted_subid = parentSubid;
+		}
+		return;
+	}
+
+	if (event != SUBXACT_EVENT_ABORT_SUB)
+		return;
+
+	hash_seq_init(&status, GttSessionRelTable);
+	while ((srel = (GttSessionRel *) hash_seq_search(&status)) != NULL)
+	{
+		if (srel->evicted && srel->evicted_subid == mySubid)
+			gtt_cancel_eviction(srel);
+		if (!srel->xact_changed)
+			continue;
+		if (GTT_KNOWN_EMPTY(srel))
+			reset_plans = true;
+		srel->tuples_valid = false;
+	}
+
+	/* see gtt_xact_callback() */
+	if (reset_plans)
+		ResetPlanCache();
+}
+
+/*
+ * Planner hook: the temporary tables of GTT are never vacuumed or analyzed
+ * by autovacuum, without statistics the planner estimates their size from
+ * the number of pages with a minimum of 10 pages. When the exact number of
+ * rows of the temporary table is known use it instead. The fraction of
+ * all-visible pages is also taken from the visibility map set by pgtt.
+ */
+static void
+gtt_get_relation_info(PlannerInfo *root, Oid relationObjectId,
+					bool inhparent, RelOptInfo *rel)
+{
+	GttSessionRel *srel;
+	Relation       relation;
+	ListCell      *lc;
+	bool           use_count;
+	bool           use_prior;
+	bool           use_expected;
+
+	if (prev_get_relation_info)
+		prev_get_relation_info(root, relationObjectId, inhparent, rel);
+
+	if (!pgtt_is_enabled || GttSessionRelTable == NULL || inhparent)
+		return;
+
+	srel = (GttSessionRel *) hash_search(GttSessionRelTable,
+									&relationObjectId, HASH_FIND, NULL);
+	if (srel == NULL)
+		return;
+
+	/* the relation is already locked by the planner */
+	relation = table_open(relationObjectId, NoLock);
+
+	/* stale entry of a temporary table dropped by hand */
+	if (relation->rd_rel->relpersistence != RELPERSISTENCE_TEMP)
+	{
+		table_close(relation, NoLock);
+		return;
+	}
+
+	/*
+	 * When the number of rows is unknown and the temporary table has
+	 * never been analyzed, the density learned from the other sessions
+	 * is a better guess than the one computed from the tuple width.
+	 */
+	use_count = (pgtt_exact_row_counts && srel->tuples_valid);
+	use_prior = (pgtt_exact_row_counts && !srel->tuples_valid
+					&& srel->prior_density > 0
+					&& relation->rd_rel->relpages == 0);
+	/* otherwise the number of rows declared for the GTT, if any */
+	use_expected = (!use_count && !use_prior && srel->expected_rows >= 0
+					&& relation->rd_rel->relpages == 0);
+
+	if (use_count || use_prior || use_expected)
+	{
+		rel->pages = RelationGetNumberOfBlocks(relation);
+
+		if (use_count)
+			rel->tuples = srel->tuples;
+		else if (use_prior)
+			rel->tuples = rint(srel->prior_density * rel->pages);
+		else
+			rel->tuples = srel->expected_rows;
+
+		foreach(lc, rel->indexlist)
+		{
+			IndexOptInfo *info = (IndexOptInfo *) lfirst(lc);
+
+			if (info->indpred == NIL || info->tuples > rel->tuples)
+				info->tuples = rel->tuples;
+		}
+	}
+
+	/* The temporary table is never vacuumed, relallvisible is always 0 */
+	if (srel->vm_used && rel->pages > 0)
+	{
+		BlockNumber allvisible;
+		BlockNumber allfrozen;
+
+		visibilitymap_count(relation, &allvisible, &allfrozen);
+		rel->allvisfrac = Min((double) allvisible / rel->pages, 1.0);
+	}
+
+	table_close(relation, NoLock);
+
+	elog(DEBUG1, "planner uses %.0f rows and %u pages for temporary table with Oid %d",
+				rel->tuples, rel->pages, relationObjectId);
+}
+
+/*
+ * Autovacuum never processes the temporary tables and VACUUM can not be
+ * run inside a transaction, so the pages of a temporary table are never
+ * marked all-visible and index-only scans always fetch the heap. Do the
+ * part of VACUUM that sets the visibility map: the pages whose tuples are
+ * all inserted by committed transactions older than the removal horizon
+ * are marked all-visible, the hint bits are set at the same time. Only the
+ * pages after the ones processed by the previous pass are visited and no
+ * more than GTT_VACUUM_MAX_PAGES at once, the next pass continues from
+ * there. The temporary tables are not WAL-logged.
+ */
+static void
+gtt_vacuum_session_rel(Relation rel, GttSessionRel *srel)
+{
+	BlockNumber    nblocks = RelationGetNumberOfBlocks(rel);
+	BlockNumber    blkno;
+	BlockNumber    last;
+	Buffer         vmbuffer = InvalidBuffer;
+	TransactionId  OldestXmin;
+	int            nset = 0;
+
+#if PG_VERSION_NUM >= 140000
+	OldestXmin = GetOldestNonRemovableTransactionId(rel);
+#else
+	OldestXmin = GetOldestXmin(rel, PROCARRAY_FLAGS_VACUUM);
+#endif
+
+	if (srel->vm_next_block > nblocks)
+		srel->vm_next_block = 0;
+	last = Min(nblocks, srel->vm_next_block + GTT_VACUUM_MAX_PAGES);
+
+	for (blkno = srel->vm_next_block; blkno < last; blkno++)
+	{
+		Buffer         buf;
+		Page           page;
+		OffsetNumber   offnum;
+		OffsetNumber   maxoff;
+		bool           all_visible = true;
+		TransactionId  cutoff_xid = InvalidTransactionId;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (VM_ALL_VISIBLE(rel, blkno, &vmbuffer))
+			continue;
+
+		/* pin the visibility map page before locking the heap page */
+		visibilitymap_pin(rel, blkno, &vmbuffer);
+
+		buf = ReadBufferExtended(rel, MAIN_FORKNUM, blkno, RBM_NORMAL, NULL);
+		LockBuffer(buf, BUFFER_LOCK_EXCLUSIVE);
+		page = BufferGetPage(buf);
+
+		if (PageIsNew(page) || PageIsEmpty(page))
+		{
+			UnlockReleaseBuffer(buf);
+			continue;
+		}
+
+		maxoff = PageGetMaxOffsetNumber(page);
+		for (offnum = FirstOffsetNumber; offnum <= maxoff && all_visible;
+					offnum = OffsetNumberNext(offnum))
+		{
+			ItemId          itemid = PageGetItemId(page, offnum);
+			HeapTupleData   tuple;
+			TransactionId   xmin;
+
+			if (!ItemIdIsUsed(itemid) || ItemIdIsRedirected(itemid))
+				continue;
+			if (ItemIdIsDead(itemid))
+			{
+				all_visible = false;
+				break;
+			}
+
+			tuple.t_data = (HeapTupleHeader) PageGetItem(page, itemid);
+			tuple.t_len = ItemIdGetLength(itemid);
+			tuple.t_tableOid = RelationGetRelid(rel);
+			ItemPointerSet(&(tuple.t_self), blkno, offnum);
+
+			if (HeapTupleSatisfiesVacuum(&tuple, OldestXmin, buf) != HEAPTUPLE_LIVE
+					|| !HeapTupleHeaderXminCommitted(tuple.t_data))
+			{
+				all_visible = false;
+				break;
+			}
+
+			xmin = HeapTupleHeaderGetXmin(tuple.t_data);
+			if (!TransactionIdPrecedes(xmin, OldestXmin))
+			{
+				all_visible = false;
+				break;
+			}
+			if (TransactionIdFollows(xmin, cutoff_xid))
+				cutoff_xid = xmin;
+		}
+
+		if (all_visible)
+		{
+			if (!PageIsAllVisible(page))
+			{
+				PageSetAllVisible(page);
+				MarkBufferDirty(buf);
+			}
+			visibilitymap_set(rel, blkno, buf, InvalidXLogRecPtr, vmbuffer,
+							cutoff_xid, VISIBILITYMAP_ALL_VISIBLE);
+			nset++;
+		}
+
+		UnlockReleaseBuffer(buf);
+	}
+
+	if (BufferIsValid(vmbuffer))
+		ReleaseBuffer(vmbuffer);
+
+	/* The last page may receive more rows, it is visited again next time */
+	if (last >= nblocks)
+	{
+		srel->vm_next_block = (last > 0) ? last - 1 : 0;
+		srel->vm_pending = false;
+		srel->inserted_since_vacuum = 0;
+	}
+	else
+		srel->vm_next_block = last;
+	srel->vm_used = true;
+
+	elog(DEBUG1, "%d pages of temporary table with Oid %d set all-visible",
+				nset, srel->temp_relid);
+}
+
+/*
+ * Planner hook: replace the scan of a temporary table of GTT known to be
+ * empty, never written or just emptied by ON COMMIT DELETE ROWS or
+ * TRUNCATE, by an empty Result node like for a constant false qual. The
+ * joins and sub-queries over it are then simplified by the planner.
+ * The plans are invalidated when rows are added to the temporary table.
+ */
+static void
+gtt_set_rel_pathlist(PlannerInfo *root, RelOptInfo *rel,
+					Index rti, RangeTblEntry *rte)
+{
+	GttSessionRel *srel;
+
+	if (prev_set_rel_pathlist)
+		prev_set_rel_pathlist(root, rel, rti, rte);
+
+	if (!pgtt_is_enabled || !pgtt_exact_row_counts || GttSessionRelTable == NULL)
+		return;
+
+	if (rte->rtekind != RTE_RELATION || rte->inh
+			|| rte->relkind != RELKIND_RELATION || IS_DUMMY_REL(rel))
+		return;
+
+	srel = (GttSessionRel *) hash_search(GttSessionRelTable,
+									&rte->relid, HASH_FIND, NULL);
+	if (srel == NULL || !GTT_KNOWN_EMPTY(srel)
+			|| get_rel_persistence(rte->relid) != RELPERSISTENCE_TEMP)
+		return;
+
+	elog(DEBUG1, "temporary table with Oid %d is empty, remove its scan", rte->relid);
+	mark_dummy_rel(rel);
+}
+
+/*
+ * Same rule as autovacuum: a temporary table must be analyzed when its
+ * number of changes exceeds the threshold plus the scale factor times
+ * the number of rows found by the last ANALYZE.
+ */
+static bool
+gtt_needs_analyze(GttSessionRel *srel)
+{
+	int     threshold;
+	double  scale_factor;
+
+	if (!pgtt_auto_analyze || !srel->auto_analyze)
+		return false;
+
+	threshold = (srel->analyze_threshold >= 0) ?
+					srel->analyze_threshold : pgtt_analyze_threshold;
+	scale_factor = (srel->analyze_scale_factor >= 0) ?
+					srel->analyze_scale_factor : pgtt_analyze_scale_factor;
+
+	return (srel->changes_since_analyze > threshold + scale_factor * srel->tuples_at_analyze);
+}
+
+/*
+ * Run an ANALYZE on the given temporary tables. ANALYZE samples the rows
+ * of the table so this is cheap even on large temporary tables, it runs
+ * in the current transaction which is allowed as for any ANALYZE command
+ * executed in a transaction block.
+ */
+static void
+gtt_analyze_session_rels(List *relids)
+{
+	ListCell *lc;
+	bool      pushed_snapshot = false;
+
+	/* Only when we can safely run a sub-command */
+	if (!IsTransactionState() || IsInParallelMode() || InSecurityRestrictedOperation())
+		return;
+
+	if (!ActiveSnapshotSet())
+	{
+		PushActiveSnapshot(GetTransactionSnapshot());
+		pushed_snapshot = true;
+	}
+
+	foreach(lc, relids)
+	{
+		Oid            temp_relid = lfirst_oid(lc);
+		char          *relname = get_rel_name(temp_relid);
+		VacuumStmt    *vacstmt;
+		RangeVar      *rv;
+		GttSessionRel *srel;
+		HeapTuple      reltup;
+
+		/* The temporary table has been dropped in between */
+		if (relname == NULL)
+			continue;
+
+		elog(DEBUG1, "analyzing temporary table \"%s\" with Oid %d", relname, temp_relid);
+
+		rv = makeRangeVar("pg_temp", relname, -1);
+		rv->relpersistence = RELPERSISTENCE_TEMP;
+
+		vacstmt = makeNode(VacuumStmt);
+		vacstmt->options = NIL;
+		vacstmt->rels = list_make1(makeVacuumRelation(rv, temp_relid, NIL));
+		vacstmt->is_vacuumcmd = false;
+
+		gtt_exec_utility_subcommand((Node *) vacstmt, "ANALYZE");
+
+		srel = (GttSessionRel *) hash_search(GttSessionRelTable,
+										&temp_relid, HASH_FIND, NULL);
+		if (srel == NULL)
+			continue;
+
+		/* Number of rows found by ANALYZE is the base of the next threshold */
+		srel->changes_since_analyze = 0;
+		reltup = SearchSysCache1(RELOID, ObjectIdGetDatum(temp_relid));
+		if (HeapTupleIsValid(reltup))
+		{
+			Form_pg_class classform = (Form_pg_class) GETSTRUCT(reltup);
+			double        relpages = classform->relpages;
+
+			srel->tuples_at_analyze = Max(classform->reltuples, 0);
+			ReleaseSysCache(reltup);
+
+			/* Share what we have learned with the other sessions */
+			if (pgtt_learn_statistics && srel->tuples_at_analyze > 0 && relpages > 0)
+				gtt_publish_statistics(srel, srel->tuples_at_analyze, relpages);
+		}
+	}
+
+	if (pushed_snapshot)
+		PopActiveSnapshot();
+}
+
+/*
+ * Replace the statistics of the columns of a relation by the ones of the
+ * columns with the same name and type of another relation. Used to seed
+ * the temporary table with the statistics stored on the "template" table
+ * and to capture the statistics of the temporary table on the "template".
+ * Returns the number of columns for which statistics have been copied.
+ */
+static int
+gtt_copy_statistics(Oid src_relid, Oid dst_relid)
+{
+	Relation     statrel;
+	SysScanDesc  scan;
+	ScanKeyData  key[1];
+	HeapTuple    tuple;
+	List        *newtuples = NIL;
+	ListCell    *lc;
+
+	statrel = table_open(StatisticRelationId, RowExclusiveLock);
+
+	ScanKeyInit(&key[0], Anum_pg_statistic_starelid, BTEqualStrategyNumber,
+				F_OIDEQ, ObjectIdGetDatum(src_relid));
+	scan = systable_beginscan(statrel, StatisticRelidAttnumInhIndexId, true,
+							NULL, 1, key);
+
+	while (HeapTupleIsValid(tuple = systable_getnext(scan)))
+	{
+		Form_pg_statistic  statform = (Form_pg_statistic) GETSTRUCT(tuple);
+		Datum              values[Natts_pg_statistic];
+		bool               nulls[Natts_pg_statistic];
+		bool               replaces[Natts_pg_statistic];
+		char              *attname;
+		AttrNumber         attnum;
+
+		/* the GTT are never inherited or partitioned */
+		if (statform->stainherit)
+			continue;
+
+		attname = get_attname(src_relid, statform->staattnum, true);
+		if (attname == NULL)
+			continue;
+		attnum = get_attnum(dst_relid, attname);
+		if (attnum == InvalidAttrNumber
+				|| get_atttype(dst_relid, attnum) != get_atttype(src_relid, statform->staattnum))
+			continue;
+
+		memset(replaces, false, sizeof(replaces));
+		replaces[Anum_pg_statistic_starelid - 1] = true;
+		values[Anum_pg_statistic_starelid - 1] = ObjectIdGetDatum(dst_relid);
+		nulls[Anum_pg_statistic_starelid - 1] = false;
+		replaces[Anum_pg_statistic_staattnum - 1] = true;
+		values[Anum_pg_statistic_staattnum - 1] = Int16GetDatum(attnum);
+		nulls[Anum_pg_statistic_staattnum - 1] = false;
+
+		newtuples = lappend(newtuples, heap_modify_tuple(tuple, RelationGetDescr(statrel),
+													values, nulls, replaces));
+	}
+	systable_endscan(scan);
+
+	if (newtuples != NIL)
+	{
+		RemoveStatistics(dst_relid, 0);
+		CommandCounterIncrement();
+
+		foreach(lc, newtuples)
+			CatalogTupleInsert(statrel, (HeapTuple) lfirst(lc));
+	}
+
+	table_close(statrel, RowExclusiveLock);
+
+	elog(DEBUG1, "statistics of %d columns copied from relation %d to relation %d",
+				list_length(newtuples), src_relid, dst_relid);
+
+	return list_length(newtuples);
+}
+
+/*
+ * Store on the "template" table of a GTT the statistics of its temporary
+ * table in the current session, after an ANALYZE of the temporary table.
+ * The temporary tables created later, in any session, will be seeded with
+ * these statistics. The GTT can be designated by its "template" table or
+ * by its temporary table. Returns the number of columns with statistics.
+ */
+Datum
+pgtt_capture_statistics(PG_FUNCTION_ARGS)
+{
+	Oid             relid = PG_GETARG_OID(0);
+	HASH_SEQ_STATUS status;
+	GttSessionRel  *srel;
+	Oid             template_relid = InvalidOid;
+	Oid             temp_relid = InvalidOid;
+	int             ncolumns;
+
+	gtt_try_load();
+
+	if (GttSessionRelTable != NULL)
+	{
+		hash_seq_init(&status, GttSessionRelTable);
+		while ((srel = (GttSessionRel *) hash_seq_search(&status)) != NULL)
+		{
+			if (srel->temp_relid == relid || srel->relid == relid)
+			{
+				template_relid = srel->relid;
+				temp_relid = srel->temp_relid;
+				hash_seq_term(&status);
+				break;
+			}
+		}
+	}
+
+	if (!OidIsValid(temp_relid) || get_rel_name(temp_relid) == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("no temporary table has been created for relation with Oid %u in this session", relid)));
+
+	if (!gtt_current_user_can_drop(template_relid))
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 errmsg("must be owner of global temporary table %s",
+						get_rel_name(template_relid))));
+
+	/* Same lock as ANALYZE to serialize the concurrent captures */
+	LockRelationOid(template_relid, ShareUpdateExclusiveLock);
+
+	gtt_analyze_session_rels(list_make1_oid(temp_relid));
+	ncolumns = gtt_copy_statistics(temp_relid, template_relid);
+
+	PG_RETURN_INT32(ncolumns);
+}
+
+/*
+ * Startup of the DestReceiver of pgtt_populate(): the columns returned by
+ * the query must be those of the temporary table, prepare the executor
+ * state used to check the constraints and to insert the index entries.
+ */
+static void
+gtt_populate_startup(DestReceiver *self, int operation, TupleDesc typeinfo)
+{
+	GttPopulateState *myState = (GttPopulateState *) self;
+	Relation          rel = myState->rel;
+	TupleDesc         reldesc = RelationGetDescr(rel);
+	RangeTblEntry    *rte;
+#if PG_VERSION_NUM >= 160000
+	RTEPermissionInfo *perminfo;
+	List             *perminfos = NIL;
+#endif
+	int               i;
+
+	if (typeinfo->natts != reldesc->natts)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATATYPE_MISMATCH),
+				 errmsg("query returns %d columns but global temporary table \"%s\" has %d",
+						typeinfo->natts, RelationGetRelationName(rel), reldesc->natts)));
+	for (i = 0; i < reldesc->natts; i++)
+	{
+		Form_pg_attribute attr = TupleDescAttr(reldesc, i);
+
+		if (attr->attisdropped || TupleDescAttr(typeinfo, i)->atttypid != attr->atttypid)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATATYPE_MISMATCH),
+					 errmsg("column %d returned by the query does not match the type of column \"%s\" of global temporary table \"%s\"",
+							i + 1, NameStr(attr->attname), RelationGetRelationName(rel)),
+					 errhint("Cast the columns of the query to the types of the table.")));
+	}
+
+	myState->estate = CreateExecutorState();
+
+	rte = makeNode(RangeTblEntry);
+	rte->rtekind = RTE_RELATION;
+	rte->relid = RelationGetRelid(rel);
+	rte->relkind = rel->rd_rel->relkind;
+	rte->rellockmode = RowExclusiveLock;
+#if PG_VERSION_NUM >= 160000
+	perminfo = addRTEPermissionInfo(&perminfos, rte);
+	perminfo->requiredPerms = ACL_INSERT;
+#if PG_VERSION_NUM >= 180000
+	ExecInitRangeTable(myState->estate, list_make1(rte), perminfos,
+					bms_make_singleton(1));
+#else
+	ExecInitRangeTable(myState->estate, list_make1(rte), perminfos);
+#endif
+#else
+	rte->requiredPerms = ACL_INSERT;
+	ExecInitRangeTable(myState->estate, list_make1(rte));
+#endif
+
+	myState->resultRelInfo = makeNode(ResultRelInfo);
+	InitResultRelInfo(myState->resultRelInfo, rel, 1, NULL, 0);
+	if (rel->rd_rel->relhasindex)
+		ExecOpenIndices(myState->resultRelInfo, false);
+#if PG_VERSION_NUM < 140000
+	myState->estate->es_result_relation_info = myState->resultRelInfo;
+#endif
+
+	myState->bistate = GetBulkInsertState();
+	myState->nslots = 0;
+	myState->nallocated = 0;
+	myState->nbytes = 0;
+	myState->processed = 0;
+}
+
+/*
+ * Buffer a row returned by the query of pgtt_populate(), the buffer is
+ * written when full.
+ */
+static bool
+gtt_populate_receive(TupleTableSlot *slot, DestReceiver *self)
+{
+	GttPopulateState *myState = (GttPopulateState *) self;
+	EState           *estate = myState->estate;
+	TupleTableSlot   *dst;
+
+	ResetPerTupleExprContext(estate);
+
+	/* the slots are released with the tuple table of the executor state */
+	if (myState->nslots == myState->nallocated)
+		myState->slots[myState->nallocated++] = table_slot_create(myState->rel,
+													&estate->es_tupleTable);
+	dst = ExecCopySlot(myState->slots[myState->nslots], slot);
+
+	if (myState->rel->rd_att->constr != NULL)
+		ExecConstraints(myState->resultRelInfo, dst, estate);
+
+	myState->nbytes += ExecFetchSlotHeapTuple(dst, false, NULL)->t_len;
+	myState->nslots++;
+	myState->processed++;
+
+	if (myState->nslots == GTT_MULTI_INSERT_TUPLES
+			|| myState->nbytes >= GTT_MULTI_INSERT_BYTES)
+	{
+		gtt_flush_multi_insert(myState->resultRelInfo, estate, myState->slots,
+							myState->nslots, myState->cid, myState->ti_options,
+							myState->bistate);
+		myState->nslots = 0;
+		myState->nbytes = 0;
+	}
+
+	return true;
+}
+
+static void
+gtt_populate_shutdown(DestReceiver *self)
+{
+	GttPopulateState *myState = (GttPopulateState *) self;
+
+	if (myState->nslots > 0)
+		gtt_flush_multi_insert(myState->resultRelInfo, myState->estate,
+							myState->slots, myState->nslots, myState->cid,
+							myState->ti_options, myState->bistate);
+
+	FreeBulkInsertState(myState->bistate);
+	ExecCloseIndices(myState->resultRelInfo);
+	ExecResetTupleTable(myState->estate->es_tupleTable, false);
+	FreeExecutorState(myState->estate);
+	myState->estate = NULL;
+}
+
+static void
+gtt_populate_destroy(DestReceiver *self)
+{
+	pfree(self);
+}
+
+/*
+ * Walker used to find if a query reads a given relation.
+ */
+static bool
+gtt_query_reads_relation_walker(Node *node, void *context)
+{
+	if (node == NULL)
+		return false;
+
+	if (IsA(node, RangeTblEntry))
+	{
+		RangeTblEntry *rte = (RangeTblEntry *) node;
+
+		return (rte->rtekind == RTE_RELATION && rte->relid == *((Oid *) context));
+	}
+
+	if (IsA(node, Query))
+		return query_tree_walker((Query *) node, gtt_query_reads_relation_walker,
+								context, QTW_EXAMINE_RTES_BEFORE);
+
+	return expression_tree_walker(node, gtt_query_reads_relation_walker, context);
+}
+
+/*
+ * Fill the temporary table of a GTT with the rows returned by a SELECT.
+ * An INSERT ... SELECT can not use parallel query, here the SELECT is
+ * planned like the query of a CREATE TABLE AS: it can be executed by
+ * parallel workers, the rows are gathered by the session and written to
+ * its temporary table in batches, frozen when the temporary table has
+ * been created in the current transaction. The temporary table is created
+ * if needed, the GTT can be designated by its "template" table or by its
+ * temporary table. Returns the number of rows inserted.
+ */
+Datum
+pgtt_populate(PG_FUNCTION_ARGS)
+{
+	Oid               relid = PG_GETARG_OID(0);
+	char             *query_string = text_to_cstring(PG_GETARG_TEXT_PP(1));
+	Oid               template_relid = relid;
+	char             *relname;
+	Gtt               gtt;
+	GttSessionRel    *srel;
+	Relation          rel;
+	List             *raw_parsetree_list;
+	List             *querytree_list;
+	Query            *query;
+	PlannedStmt      *plan;
+	QueryDesc        *queryDesc;
+	GttPopulateState *myState;
+	uint64            processed;
+	bool              was_empty;
+
+	gtt_try_load();
+
+	/* The GTT can be designated by its temporary table */
+	if (GttSessionRelTable != NULL)
+	{
+		srel = (GttSessionRel *) hash_search(GttSessionRelTable,
+										&relid, HASH_FIND, NULL);
+		if (srel != NULL)
+			template_relid = srel->relid;
+	}
+
+	gtt.relid = 0;
+	relname = get_rel_name(template_relid);
+	if (relname != NULL && GttHashTable != NULL)
+		GttHashTableLookup(relname, gtt);
+	if (gtt.relid == 0 || gtt.relid != template_relid)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("relation with Oid %u is not a global temporary table", relid)));
+
+	gtt_instantiate(NULL, &gtt, true);
+
+	/* Parse, analyze and rewrite the query, the GTT are rerouted */
+	raw_parsetree_list = pg_parse_query(query_string);
+	if (list_length(raw_parsetree_list) != 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("pgtt_populate() expects a single SELECT query")));
+#if PG_VERSION_NUM >= 150000
+	querytree_list = pg_analyze_and_rewrite_fixedparams(linitial_node(RawStmt, raw_parsetree_list),
+								query_string, NULL, 0, NULL);
+#else
+	querytree_list = pg_analyze_and_rewrite(linitial_node(RawStmt, raw_parsetree_list),
+								query_string, NULL, 0, NULL);
+#endif
+	if (list_length(querytree_list) != 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("pgtt_populate() expects a single SELECT query")));
+	query = linitial_node(Query, querytree_list);
+	if (query->commandType != CMD_SELECT || query->utilityStmt != NULL
+			|| query->rowMarks != NIL || query->hasModifyingCTE)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("pgtt_populate() expects a single SELECT query")));
+
+	gtt_create_lazy_toast(gtt.temp_relid);
+	rel = table_open(gtt.temp_relid, RowExclusiveLock);
+
+	/* The rows are written directly to the table */
+	if (rel->trigdesc != NULL
+			|| (rel->rd_att->constr != NULL && rel->rd_att->constr->has_generated_stored))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("pgtt_populate() can not be used with a global temporary table with triggers or generated columns"),
+				 errhint("Use INSERT INTO ... SELECT instead.")));
+
+	myState = (GttPopulateState *) palloc0(sizeof(GttPopulateState));
+	myState->pub.receiveSlot = gtt_populate_receive;
+	myState->pub.rStartup = gtt_populate_startup;
+	myState->pub.rShutdown = gtt_populate_shutdown;
+	myState->pub.rDestroy = gtt_populate_destroy;
+	myState->pub.mydest = DestNone;
+	myState->rel = rel;
+
+	/*
+	 * Write the rows frozen under the same conditions as COPY FREEZE and if
+	 * the query does not read the table, it would see the rows inserted.
+	 */
+	myState->ti_options = TABLE_INSERT_SKIP_FSM;
+	if (pgtt_freeze_on_load && rel->rd_rel->relam == HEAP_TABLE_AM_OID
+			&& (rel->rd_createSubid == GetCurrentSubTransactionId()
+				|| GTT_NEW_STORAGE_SUBID(rel) == GetCurrentSubTransactionId())
+			&& ThereAreNoPriorRegisteredSnapshots() && ThereAreNoReadyPortals()
+			&& !gtt_query_reads_relation_walker((Node *) query, (void *) &gtt.temp_relid))
+		myState->ti_options |= TABLE_INSERT_FROZEN;
+
+	/* plan the query as the one of a CREATE TABLE AS, it can run in parallel */
+#if PG_VERSION_NUM >= 130000
+	plan = pg_plan_query(query, query_string, CURSOR_OPT_PARALLEL_OK, NULL);
+#else
+	plan = pg_plan_query(query, CURSOR_OPT_PARALLEL_OK, NULL);
+#endif
+
+	/* A volatile function could read the table and see the frozen rows */
+	if (myState->ti_options & TABLE_INSERT_FROZEN)
+	{
+		ListCell   *lc;
+
+		if (gtt_plan_has_volatile(plan->planTree))
+			myState->ti_options &= ~TABLE_INSERT_FROZEN;
+		foreach(lc, plan->subplans)
+		{
+			if (gtt_plan_has_volatile((Plan *) lfirst(lc)))
+				myState->ti_options &= ~TABLE_INSERT_FROZEN;
+		}
+	}
+
+	/*
+	 * The transaction id and the command id must be set before entering
+	 * parallel mode, the rows are only written by the session.
+	 */
+	(void) GetCurrentTransactionId();
+	PushCopiedSnapshot(GetActiveSnapshot());
+	UpdateActiveSnapshotCommandId();
+	myState->cid = GetCurrentCommandId(true);
+
+	queryDesc = CreateQueryDesc(plan, query_string,
+								GetActiveSnapshot(), InvalidSnapshot,
+								(DestReceiver *) myState, NULL, NULL, 0);
+
+	ExecutorStart(queryDesc, 0);
+#if PG_VERSION_NUM >= 180000
+	ExecutorRun(queryDesc, ForwardScanDirection, 0);
+#else
+	ExecutorRun(queryDesc, ForwardScanDirection, 0, true);
+#endif
+	processed = myState->processed;
+	ExecutorFinish(queryDesc);
+	ExecutorEnd(queryDesc);
+	FreeQueryDesc(queryDesc);
+	PopActiveSnapshot();
+
+	table_close(rel, NoLock);
+
+	elog(DEBUG1, UINT64_FORMAT " rows inserted into temporary table with Oid %d%s",
+				processed, gtt.temp_relid,
+				(myState->ti_options & TABLE_INSERT_FROZEN) ? " frozen" : "");
+
+	/* Maintain the number of rows of the temporary table */
+	srel = (GttSessionRel *) hash_search(GttSessionRelTable,
+									&gtt.temp_relid, HASH_FIND, NULL);
+	if (srel != NULL)
+	{
+		was_empty = GTT_KNOWN_EMPTY(srel);
+		srel->tuples += processed;
+		srel->changes_since_analyze += processed;
+		srel->xact_inserted += processed;
+		srel->xact_changed = true;
+#if PG_VERSION_NUM >= 140000
+		if ((myState->ti_options & TABLE_INSERT_FROZEN) && processed > 0)
+			srel->vm_used = true;
+#endif
+		if (was_empty && !GTT_KNOWN_EMPTY(srel))
+			CacheInvalidateRelcacheByRelid(srel->temp_relid);
+
+		if (pgtt_is_enabled && gtt_needs_analyze(srel))
+			gtt_analyze_session_rels(list_make1_oid(srel->temp_relid));
+	}
+
+	(*myState->pub.rDestroy) ((DestReceiver *) myState);
+
+	PG_RETURN_INT64(processed);
+}
+
+/*
+ * Return the Oid of the table storing the statistics shared between the
+ * sessions, InvalidOid if the extension has not been updated yet.
+ */
+static Oid
+gtt_learned_stats_relid(void)
+{
+	if (!OidIsValid(pgtt_namespace_oid))
+		return InvalidOid;
+
+	return get_relname_relid(CATALOG_GLOBAL_TEMP_STATS, pgtt_namespace_oid);
+}
+
+/*
+ * Load in the session state of a temporary table the statistics learned
+ * from the other sessions for its GTT. They are used by the planner as
+ * long as the temporary table has not been analyzed.
+ */
+static void
+gtt_load_learned_statistics(GttSessionRel *srel)
+{
+	char          *query;
+	Oid            argtypes[1] = { OIDOID };
+	Datum          args[1];
+	bool           pushed_snapshot = false;
+	MemoryContext  oldcontext;
+
+	if (srel == NULL || !OidIsValid(gtt_learned_stats_relid()))
+		return;
+
+	if (!ActiveSnapshotSet())
+	{
+		PushActiveSnapshot(GetTransactionSnapshot());
+		pushed_snapshot = true;
+	}
+
+	query = psprintf("SELECT tuples, pages, widths, ndistinct FROM %s.%s"
+						" WHERE relid OPERATOR(pg_catalog.=) $1 AND samples OPERATOR(pg_catalog.>) 0",
+						quote_identifier(pgtt_namespace_name), CATALOG_GLOBAL_TEMP_STATS);
+	args[0] = ObjectIdGetDatum(srel->relid);
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "could not connect to SPI manager");
+
+	if (SPI_execute_with_args(query, 1, argtypes, args, NULL, true, 1) == SPI_OK_SELECT
+			&& SPI_processed == 1)
+	{
+		TupleDesc   tupdesc = SPI_tuptable->tupdesc;
+		HeapTuple   tuple = SPI_tuptable->vals[0];
+		bool        isnull;
+		bool        wnull;
+		bool        nnull;
+		Datum       tuples = SPI_getbinval(tuple, tupdesc, 1, &isnull);
+		Datum       pages = SPI_getbinval(tuple, tupdesc, 2, &isnull);
+		Datum       widths = SPI_getbinval(tuple, tupdesc, 3, &wnull);
+		Datum       ndistinct = SPI_getbinval(tuple, tupdesc, 4, &nnull);
+		int         natts = get_relnatts(srel->temp_relid);
+
+		if (DatumGetFloat8(pages) > 0)
+			srel->prior_density = DatumGetFloat8(tuples) / DatumGetFloat8(pages);
+
+		oldcontext = MemoryContextSwitchTo(CacheMemoryContext);
+		srel->prior_natts = natts;
+		srel->prior_widths = (int32 *) palloc0(sizeof(int32) * natts);
+		srel->prior_ndistinct = (float4 *) palloc0(sizeof(float4) * natts);
+		MemoryContextSwitchTo(oldcontext);
+
+		if (!wnull && !nnull)
+		{
+			ArrayType  *warr = DatumGetArrayTypeP(widths);
+			ArrayType  *narr = DatumGetArrayTypeP(ndistinct);
+			int32      *wvals = (int32 *) ARR_DATA_PTR(warr);
+			float4     *nvals = (float4 *) ARR_DATA_PTR(narr);
+			int         nvalues = Min(ArrayGetNItems(ARR_NDIM(warr), ARR_DIMS(warr)),
+									ArrayGetNItems(ARR_NDIM(narr), ARR_DIMS(narr)));
+			int         i;
+
+			if (ARR_HASNULL(warr) || ARR_HASNULL(narr))
+				nvalues = 0;
+
+			/* the columns of the temporary table are matched by name */
+			for (i = 0; i < nvalues; i++)
+			{
+				char       *attname = get_attname(srel->relid, i + 1, true);
+				AttrNumber  attnum;
+
+				if (attname == NULL)
+					continue;
+				attnum = get_attnum(srel->temp_relid, attname);
+				if (attnum <= 0 || attnum > natts)
+					continue;
+				srel->prior_widths[attnum - 1] = wvals[i];
+				srel->prior_ndistinct[attnum - 1] = nvals[i];
+			}
+		}
+
+		elog(DEBUG1, "learned density of %.1f rows per page loaded for temporary table with Oid %d",
+					srel->prior_density, srel->temp_relid);
+	}
+
+	SPI_finish();
+
+	if (pushed_snapshot)
+		PopActiveSnapshot();
+}
+
+/*
+ * Return the Oid of the registry of the GTT when it can store the options
+ * of the GTT, InvalidOid if the extension has not been updated yet.
+ */
+static Oid
+gtt_registry_options_relid(void)
+{
+	Oid relid;
+
+	if (!OidIsValid(pgtt_namespace_oid))
+		return InvalidOid;
+
+	relid = get_relname_relid(CATALOG_GLOBAL_TEMP_REL, pgtt_namespace_oid);
+	if (!OidIsValid(relid) || get_attnum(relid, "options") == InvalidAttrNumber)
+		return InvalidOid;
+
+	return relid;
+}
+
+/*
+ * Validate an option of a GTT stored in the registry and apply it to the
+ * session state of a temporary table when one is given. A NULL value
+ * resets the option. Returns false when the option is invalid and elevel
+ * is lower than ERROR.
+ */
+static bool
+gtt_check_registry_option(const char *name, const char *value,
+					GttSessionRel *srel, int elevel)
+{
+	if (strcmp(name, "expected_rows") == 0)
+	{
+		int rows = -1;
+
+		if (value != NULL && (!parse_int(value, &rows, 0, NULL) || rows < 0))
+		{
+			ereport(elevel,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("invalid value for global temporary table option \"%s\": \"%s\"",
+							name, value)));
+			return false;
+		}
+		if (srel != NULL)
+			srel->expected_rows = rows;
+		return true;
+	}
+
+	/* read at the load of the GTT list, see gtt_load_global_temporary_tables() */
+	if (strcmp(name, "seeded") == 0)
+	{
+		bool seeded;
+
+		if (value != NULL && !parse_bool(value, &seeded))
+		{
+			ereport(elevel,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("invalid value for global temporary table option \"%s\": \"%s\"",
+							name, value)));
+			return false;
+		}
+		return true;
+	}
+
+	if (strcmp(name, "buffer_budget") == 0)
+	{
+		int blocks = -1;
+
+		if (value != NULL && (!parse_int(value, &blocks, GUC_UNIT_BLOCKS, NULL) || blocks < 0))
+		{
+			ereport(elevel,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("invalid value for global temporary table option \"%s\": \"%s\"",
+							name, value)));
+			return false;
+		}
+		if (srel != NULL)
+			srel->buffer_budget = blocks;
+		return true;
+	}
+
+	/* used by the temporary tables created later */
+	if (strcmp(name, "access_method") == 0)
+	{
+		if (value != NULL && !OidIsValid(get_table_am_oid(value, true)))
+		{
+			ereport(elevel,
+					(errcode(ERRCODE_UNDEFINED_OBJECT),
+					 errmsg("table access method \"%s\" does not exist", value)));
+			return false;
+		}
+		return true;
+	}
+
+	/* list of tablespaces, the first usable one is used */
+	if (strcmp(name, "tablespace") == 0)
+	{
+		List       *namelist;
+		ListCell   *lc;
+
+		if (value == NULL)
+			return true;
+
+		if (!SplitIdentifierString(pstrdup(value), ',', &namelist) || namelist == NIL)
+		{
+			ereport(elevel,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("invalid list syntax for global temporary table option \"%s\"", name)));
+			return false;
+		}
+		foreach(lc, namelist)
+		{
+			char *spcname = (char *) lfirst(lc);
+			Oid   spcid = get_tablespace_oid(spcname, true);
+
+			if (!OidIsValid(spcid))
+			{
+				ereport(elevel,
+						(errcode(ERRCODE_UNDEFINED_OBJECT),
+						 errmsg("tablespace \"%s\" does not exist", spcname)));
+				return false;
+			}
+			if (spcid == GLOBALTABLESPACE_OID)
+			{
+				ereport(elevel,
+						(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+						 errmsg("only shared relations can be placed in pg_global tablespace")));
+				return false;
+			}
+		}
+		return true;
+	}
+
+	ereport(elevel,
+			(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+			 errmsg("unrecognized global temporary table option \"%s\"", name)));
+	return false;
+}
+
+/*
+ * Read with a single query the options of a GTT stored in the registry,
+ * they are used to create its temporary table and to fill its session
+ * state.
+ */
+static void
+gtt_read_registry_options(Oid relid, GttRegistryOptions *opts)
+{
+	char          *query;
+	Oid            argtypes[1] = { INT4OID };
+	Datum          args[1];
+	bool           pushed_snapshot = false;
+	MemoryContext  callercontext = CurrentMemoryContext;
+	uint64         i;
+
+	memset(opts, 0, sizeof(GttRegistryOptions));
+
+	if (!OidIsValid(gtt_registry_options_relid()))
+		return;
+
+	if (!ActiveSnapshotSet())
+	{
+		PushActiveSnapshot(GetTransactionSnapshot());
+		pushed_snapshot = true;
+	}
+
+	query = psprintf("SELECT pg_catalog.split_part(o, '=', 1), pg_catalog.substr(o, pg_catalog.strpos(o, '=') + 1)"
+					" FROM %s.%s r, pg_catalog.unnest(r.options) o WHERE r.relid OPERATOR(pg_catalog.=) $1",
+						quote_identifier(pgtt_namespace_name), CATALOG_GLOBAL_TEMP_REL);
+	args[0] = Int32GetDatum(relid);
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "could not connect to SPI manager");
+
+	if (SPI_execute_with_args(query, 1, argtypes, args, NULL, true, 0) == SPI_OK_SELECT)
+	{
+		for (i = 0; i < SPI_processed; i++)
+		{
+			char          *name = SPI_getvalue(SPI_tuptable->vals[i], SPI_tuptable->tupdesc, 1);
+			char          *value = SPI_getvalue(SPI_tuptable->vals[i], SPI_tuptable->tupdesc, 2);
+			MemoryContext  spicontext;
+
+			if (name == NULL)
+				continue;
+
+			/* the options must survive SPI_finish() */
+			spicontext = MemoryContextSwitchTo(callercontext);
+			name = pstrdup(name);
+			if (value != NULL)
+				value = pstrdup(value);
+			opts->names = lappend(opts->names, name);
+			opts->values = lappend(opts->values, value);
+			MemoryContextSwitchTo(spicontext);
+
+			if (strcmp(name, "access_method") == 0)
+				opts->access_method = value;
+			else if (strcmp(name, "tablespace") == 0)
+				opts->tablespace = value;
+			else if (strcmp(name, "seeded") == 0 && value != NULL)
+				(void) parse_bool(value, &opts->seeded);
+		}
+	}
+
+	SPI_finish();
+
+	if (pushed_snapshot)
+		PopActiveSnapshot();
+}
+
+/*
+ * Apply to the session state of a temporary table the options of its GTT
+ * read from the registry. The options that can not be understood, set by
+ * a more recent version for example, are ignored.
+ */
+static void
+gtt_apply_registry_options(GttSessionRel *srel, GttRegistryOptions *opts)
+{
+	ListCell   *lc1;
+	ListCell   *lc2;
+
+	if (srel == NULL)
+		return;
+
+	forboth(lc1, opts->names, lc2, opts->values)
+	{
+		char *name = (char *) lfirst(lc1);
+		char *value = (char *) lfirst(lc2);
+
+		if (gtt_check_registry_option(name, value, srel, DEBUG1))
+			elog(DEBUG1, "option %s = %s applied to temporary table with Oid %d",
+						name, value, srel->temp_relid);
+	}
+}
+
+/*
+ * Set an option of a GTT in the registry, a NULL value removes it.
+ */
+static void
+gtt_store_registry_option(Oid relid, const char *name, const char *value)
+{
+	char           *query;
+	Oid             argtypes[3] = { INT4OID, TEXTOID, TEXTOID };
+	Datum           args[3];
+	char            nulls[3] = { ' ', ' ', ' ' };
+
+	if (!OidIsValid(gtt_registry_options_relid()))
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("the options of the global temporary tables require an update of the pgtt extension")));
+
+	query = psprintf("UPDATE %s.%s SET options = NULLIF(pg_catalog.array_cat("
+					"ARRAY(SELECT o FROM pg_catalog.unnest(options) o WHERE pg_catalog.split_part(o, '=', 1) OPERATOR(pg_catalog.<>) $2),"
+					" CASE WHEN $3 IS NULL THEN NULL ELSE ARRAY[$2 OPERATOR(pg_catalog.||) '=' OPERATOR(pg_catalog.||) $3] END), '{}')"
+					" WHERE relid OPERATOR(pg_catalog.=) $1",
+						quote_identifier(pgtt_namespace_name), CATALOG_GLOBAL_TEMP_REL);
+	args[0] = Int32GetDatum(relid);
+	args[1] = CStringGetTextDatum(name);
+	if (value != NULL)
+		args[2] = CStringGetTextDatum(value);
+	else
+	{
+		args[2] = (Datum) 0;
+		nulls[2] = 'n';
+	}
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "could not connect to SPI manager");
+
+	if (SPI_execute_with_args(query, 3, argtypes, args, nulls, false, 0) != SPI_OK_UPDATE)
+		ereport(ERROR,
+				(errmsg("can not set option \"%s\" of global temporary table %s",
+						name, get_rel_name(relid))));
+
+	if (SPI_processed == 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_UNDEFINED_OBJECT),
+				 errmsg("global temporary table %s is not registered", get_rel_name(relid))));
+
+	SPI_finish();
+}
+
+/*
+ * Make the "template" table of a GTT logged or unlogged again. The rows
+ * of the "template" of a seeded GTT are shared by all the sessions, they
+ * must survive a crash and be readable on a standby.
+ */
+static void
+gtt_set_template_logged(Oid relid, bool logged)
+{
+	char    *query;
+	char     persistence = get_rel_persistence(relid);
+
+	if (persistence == (logged ? RELPERSISTENCE_PERMANENT : RELPERSISTENCE_UNLOGGED))
+		return;
+
+	query = psprintf("ALTER TABLE %s.%s SET %s",
+					 quote_identifier(pgtt_namespace_name),
+					 quote_identifier(get_rel_name(relid)),
+					 logged ? "LOGGED" : "UNLOGGED");
+
+	elog(DEBUG1, "changing persistence of template table with relid %u: %s", relid, query);
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "could not connect to SPI manager");
+
+	if (SPI_exec(query, 0) != SPI_OK_UTILITY)
+		ereport(ERROR, (errmsg("execution failure on query: \"%s\"", query)));
+
+	SPI_finish();
+}
+
+/*
+ * Set an option of a GTT in the registry, a NULL value removes it. The
+ * options are applied to the temporary tables created later, and at once
+ * to the temporary table of the current session. The GTT can be designated
+ * by its "template" table or by its temporary table. Reserved to the owner
+ * of the GTT.
+ */
+Datum
+pgtt_set_option(PG_FUNCTION_ARGS)
+{
+	Oid             relid;
+	char           *name;
+	char           *value = NULL;
+	HASH_SEQ_STATUS status;
+	GttSessionRel  *entry;
+	GttSessionRel  *srel = NULL;
+
+	if (PG_ARGISNULL(0) || PG_ARGISNULL(1))
+		ereport(ERROR,
+				(errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+				 errmsg("the relation and the name of the option can not be NULL")));
+
+	relid = PG_GETARG_OID(0);
+	name = text_to_cstring(PG_GETARG_TEXT_PP(1));
+	if (!PG_ARGISNULL(2))
+		value = text_to_cstring(PG_GETARG_TEXT_PP(2));
+
+	gtt_try_load();
+
+	if (GttSessionRelTable != NULL)
+	{
+		hash_seq_init(&status, GttSessionRelTable);
+		while ((entry = (GttSessionRel *) hash_seq_search(&status)) != NULL)
+		{
+			if (entry->temp_relid == relid || entry->relid == relid)
+			{
+				srel = entry;
+				relid = entry->relid;
+				hash_seq_term(&status);
+				break;
+			}
+		}
+	}
+
+	if (!OidIsValid(pgtt_namespace_oid) || get_rel_namespace(relid) != pgtt_namespace_oid)
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("relation with Oid %u is not a global temporary table", relid)));
+
+	if (!gtt_current_user_can_drop(relid))
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 errmsg("must be owner of global temporary table %s",
+						get_rel_name(relid))));
+
+	(void) gtt_check_registry_option(name, value, NULL, ERROR);
+
+	if (strcmp(name, "seeded") == 0 && value != NULL
+			&& (get_rel_relkind(relid) != RELKIND_RELATION || get_rel_relispartition(relid)))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("a partitioned global temporary table can not be seeded")));
+
+	gtt_store_registry_option(relid, name, value);
+
+	if (srel != NULL)
+		(void) gtt_check_registry_option(name, value, srel, ERROR);
+
+	/*
+	 * The rows of a seeded "template" are logged. The queries of this
+	 * session follow the new seeded option from the next statement, the
+	 * other sessions once this transaction commits.
+	 */
+	if (strcmp(name, "seeded") == 0)
+	{
+		bool seeded = false;
+
+		if (value != NULL)
+			(void) parse_bool(value, &seeded);
+		gtt_set_template_logged(relid, seeded);
+
+		CacheInvalidateRelcacheByRelid(gtt_registry_options_relid());
+		gtt_seeded_pending = true;
+		gtt_seeded_changed = true;
+	}
+
+	PG_RETURN_VOID();
+}
+
+/*
+ * Return the number of local buffers holding a block of the temporary
+ * table of a GTT in the current session, 0 when it has not been created.
+ */
+Datum
+pgtt_local_buffers(PG_FUNCTION_ARGS)
+{
+	Oid             relid = PG_GETARG_OID(0);
+	HASH_SEQ_STATUS status;
+	GttSessionRel  *srel;
+	Relation        rel;
+	int64           count = 0;
+	int             i;
+
+	if (GttSessionRelTable != NULL && get_rel_namespace(relid) == pgtt_namespace_oid)
+	{
+		hash_seq_init(&status, GttSessionRelTable);
+		while ((srel = (GttSessionRel *) hash_seq_search(&status)) != NULL)
+		{
+			if (srel->relid == relid && !srel->evicted)
+			{
+				relid = srel->temp_relid;
+				hash_seq_term(&status);
+				break;
+			}
+		}
+	}
+
+	if (get_rel_persistence(relid) != RELPERSISTENCE_TEMP)
+		PG_RETURN_INT64(0);
+
+	rel = RelationIdGetRelation(relid);
+	if (!RelationIsValid(rel))
+		PG_RETURN_INT64(0);
+
+	for (i = 0; i < NLocBuffer; i++)
+	{
+		BufferDesc *bufHdr = GetLocalBufferDescriptor(i);
+
+		if (!(pg_atomic_read_u32(&bufHdr->state) & BM_TAG_VALID))
+			continue;
+#if PG_VERSION_NUM >= 160000
+		if (BufTagGetRelNumber(&bufHdr->tag) == rel->rd_locator.relNumber)
+#else
+		if (bufHdr->tag.rnode.relNode == rel->rd_node.relNode)
+#endif
+			count++;
+	}
+	RelationClose(rel);
+
+	PG_RETURN_INT64(count);
+}
+
+/*
+ * Give back to the system the memory of the local buffers of the session
+ * that do not hold a block, returns the number of buffers released.
+ */
+Datum
+pgtt_release_local_buffers(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_INT64(gtt_release_local_buffers());
+}
+
+/*
+ * Return the next value of the session-local counter of a sequence of a
+ * "template" table. The counter starts at the START value of the sequence
+ * and follows its increment, bounds and CYCLE option, but it is never
+ * shared with the other sessions nor stored.
+ */
+Datum
+pgtt_nextval(PG_FUNCTION_ARGS)
+{
+	Oid             seqid = PG_GETARG_OID(0);
+	GttSeqCounter  *counter;
+	bool            found;
+
+	if (pg_class_aclcheck(seqid, GetUserId(), ACL_USAGE | ACL_UPDATE) != ACLCHECK_OK)
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 errmsg("permission denied for sequence %s",
+						get_rel_name(seqid))));
+
+	if (GttSeqTable == NULL)
+	{
+		HASHCTL         ctl;
+
+		MemSet(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(Oid);
+		ctl.entrysize = sizeof(GttSeqCounter);
+		ctl.hcxt = CacheMemoryContext;
+		GttSeqTable = hash_create("Global Temporary Table session sequences",
+									GTT_PER_DATABASE,
+									&ctl,
+									HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	counter = (GttSeqCounter *) hash_search(GttSeqTable, &seqid, HASH_ENTER, &found);
+	if (!found)
+	{
+		HeapTuple         tuple;
+		Form_pg_sequence  seqform;
+
+		tuple = SearchSysCache1(SEQRELID, ObjectIdGetDatum(seqid));
+		if (!HeapTupleIsValid(tuple))
+		{
+			hash_search(GttSeqTable, &seqid, HASH_REMOVE, NULL);
+			ereport(ERROR,
+					(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+					 errmsg("relation with Oid %u is not a sequence", seqid)));
+		}
+		seqform = (Form_pg_sequence) GETSTRUCT(tuple);
+		counter->start = seqform->seqstart;
+		counter->increment = seqform->seqincrement;
+		counter->minv = seqform->seqmin;
+		counter->maxv = seqform->seqmax;
+		counter->cycle = seqform->seqcycle;
+		counter->called = false;
+		counter->last = 0;
+		ReleaseSysCache(tuple);
+	}
+
+	if (!counter->called)
+	{
+		counter->last = counter->start;
+		counter->called = true;
+	}
+	else if (counter->increment > 0 && counter->last > counter->maxv - counter->increment)
+	{
+		if (!counter->cycle)
+			ereport(ERROR,
+					(errcode(ERRCODE_SEQUENCE_GENERATOR_LIMIT_EXCEEDED),
+					 errmsg("nextval: reached maximum value of sequence \"%s\" (" INT64_FORMAT ")",
+							get_rel_name(seqid), counter->maxv)));
+		counter->last = counter->minv;
+	}
+	else if (counter->increment < 0 && counter->last < counter->minv - counter->increment)
+	{
+		if (!counter->cycle)
+			ereport(ERROR,
+					(errcode(ERRCODE_SEQUENCE_GENERATOR_LIMIT_EXCEEDED),
+					 errmsg("nextval: reached minimum value of sequence \"%s\" (" INT64_FORMAT ")",
+							get_rel_name(seqid), counter->minv)));
+		counter->last = counter->maxv;
+	}
+	else
+		counter->last += counter->increment;
+
+	PG_RETURN_INT64(counter->last);
+}
+
+/*
+ * Publish the statistics found by ANALYZE on a temporary table so that
+ * the other sessions can use them before their own ANALYZE. The values
+ * are averaged with the previous ones over the last GTT_STATS_WINDOW
+ * samples. This must never get in the way of the user transaction: the
+ * update is done as the owner of the table in a subtransaction and it is
+ * skipped when another session is publishing for the same GTT or when it
+ * fails for any reason.
+ */
+static void
+gtt_publish_statistics(GttSessionRel *srel, double reltuples, double relpages)
+{
+	Oid             statsrelid = gtt_learned_stats_relid();
+	Oid             statsowner;
+	HeapTuple       reltup;
+	Oid             save_userid;
+	int             save_sec_context;
+	int             natts;
+	int             i;
+	Datum          *widths;
+	Datum          *ndistinct;
+	MemoryContext   oldcontext = CurrentMemoryContext;
+	ResourceOwner   oldowner = CurrentResourceOwner;
+
+	if (!OidIsValid(statsrelid))
+		return;
+
+	reltup = SearchSysCache1(RELOID, ObjectIdGetDatum(statsrelid));
+	if (!HeapTupleIsValid(reltup))
+		return;
+	statsowner = ((Form_pg_class) GETSTRUCT(reltup))->relowner;
+	ReleaseSysCache(reltup);
+
+	/* Width and number of distinct values of each column of the "template" */
+	natts = get_relnatts(srel->relid);
+	widths = (Datum *) palloc0(sizeof(Datum) * Max(natts, 1));
+	ndistinct = (Datum *) palloc0(sizeof(Datum) * Max(natts, 1));
+	for (i = 0; i < natts; i++)
+	{
+		char       *attname = get_attname(srel->relid, i + 1, true);
+		AttrNumber  attnum = InvalidAttrNumber;
+		HeapTuple   stattup;
+
+		widths[i] = Int32GetDatum(0);
+		ndistinct[i] = Float4GetDatum(0);
+		if (attname != NULL)
+			attnum = get_attnum(srel->temp_relid, attname);
+		if (attnum <= 0)
+			continue;
+
+		stattup = SearchSysCache3(STATRELATTINH,
+								ObjectIdGetDatum(srel->temp_relid),
+								Int16GetDatum(attnum),
+								BoolGetDatum(false));
+		if (HeapTupleIsValid(stattup))
+		{
+			Form_pg_statistic statform = (Form_pg_statistic) GETSTRUCT(stattup);
+
+			widths[i] = Int32GetDatum(statform->stawidth);
+			ndistinct[i] = Float4GetDatum(statform->stadistinct);
+			ReleaseSysCache(stattup);
+		}
+	}
+
+	GetUserIdAndSecContext(&save_userid, &save_sec_context);
+
+	BeginInternalSubTransaction(NULL);
+	MemoryContextSwitchTo(oldcontext);
+
+	PG_TRY();
+	{
+		char       *nspname = quote_identifier(pgtt_namespace_name);
+		Oid         argtypes[6] = { OIDOID, INT8OID, FLOAT8OID, FLOAT8OID, INT4ARRAYOID, FLOAT4ARRAYOID };
+		Datum       args[6];
+		int64       samples = 1;
+		double      tuples = reltuples;
+		double      pages = relpages;
+		bool        found;
+
+		/* The user may not be allowed to write to the table */
+		SetUserIdAndSecContext(statsowner,
+							save_sec_context | SECURITY_LOCAL_USERID_CHANGE
+							| SECURITY_RESTRICTED_OPERATION);
+
+		if (SPI_connect() != SPI_OK_CONNECT)
+			elog(ERROR, "could not connect to SPI manager");
+
+		args[0] = ObjectIdGetDatum(srel->relid);
+		if (SPI_execute_with_args(psprintf("SELECT samples, tuples, pages, widths, ndistinct FROM %s.%s"
+								" WHERE relid OPERATOR(pg_catalog.=) $1 FOR UPDATE SKIP LOCKED",
+								nspname, CATALOG_GLOBAL_TEMP_STATS),
+								1, argtypes, args, NULL, false, 1) != SPI_OK_SELECT)
+			elog(ERROR, "could not read learned statistics");
+
+		found = (SPI_processed == 1);
+		if (found)
+		{
+			TupleDesc   tupdesc = SPI_tuptable->tupdesc;
+			HeapTuple   tuple = SPI_tuptable->vals[0];
+			bool        isnull;
+			bool        wnull;
+			bool        nnull;
+			Datum       owidths;
+			Datum       ondistinct;
+			double      weight;
+
+			samples = DatumGetInt64(SPI_getbinval(tuple, tupdesc, 1, &isnull)) + 1;
+			weight = 1.0 / Min(samples, GTT_STATS_WINDOW);
+			tuples = DatumGetFloat8(SPI_getbinval(tuple, tupdesc, 2, &isnull));
+			tuples += weight * (reltuples - tuples);
+			pages = DatumGetFloat8(SPI_getbinval(tuple, tupdesc, 3, &isnull));
+			pages += weight * (relpages - pages);
+
+			owidths = SPI_getbinval(tuple, tupdesc, 4, &wnull);
+			ondistinct = SPI_getbinval(tuple, tupdesc, 5, &nnull);
+			if (!wnull && !nnull)
+			{
+				ArrayType  *warr = DatumGetArrayTypeP(owidths);
+				ArrayType  *narr = DatumGetArrayTypeP(ondistinct);
+
+				if (!ARR_HASNULL(warr) && !ARR_HASNULL(narr)
+						&& ArrayGetNItems(ARR_NDIM(warr), ARR_DIMS(warr)) == natts
+						&& ArrayGetNItems(ARR_NDIM(narr), ARR_DIMS(narr)) == natts)
+				{
+					int32  *wvals = (int32 *) ARR_DATA_PTR(warr);
+					float4 *nvals = (float4 *) ARR_DATA_PTR(narr);
+
+					for (i = 0; i < natts; i++)
+					{
+						int32   width = DatumGetInt32(widths[i]);
+						float4  nd = DatumGetFloat4(ndistinct[i]);
+
+						/* no new value for this column, keep the old one */
+						if (width <= 0)
+						{
+							widths[i] = Int32GetDatum(wvals[i]);
+							ndistinct[i] = Float4GetDatum(nvals[i]);
+							continue;
+						}
+						if (wvals[i] > 0)
+							widths[i] = Int32GetDatum((int32) rint(wvals[i] + weight * (width - wvals[i])));
+						/* a number of distinct values can not be averaged with a fraction of rows */
+						if ((nvals[i] > 0 && nd > 0) || (nvals[i] < 0 && nd < 0))
+							ndistinct[i] = Float4GetDatum(nvals[i] + weight * (nd - nvals[i]));
+					}
+				}
+			}
+		}
+
+		args[1] = Int64GetDatum(samples);
+		args[2] = Float8GetDatum(tuples);
+		args[3] = Float8GetDatum(pages);
+		args[4] = PointerGetDatum(construct_array(widths, natts, INT4OID, sizeof(int32), true, 'i'));
+		args[5] = PointerGetDatum(construct_array(ndistinct, natts, FLOAT4OID, sizeof(float4), true, 'i'));
+
+		/*
+		 * The row is created with the GTT but it is missing after a restore
+		 * of the registry. Nothing is done when another session has it locked.
+		 */
+		if (found)
+			SPI_execute_with_args(psprintf("UPDATE %s.%s SET samples = $2, tuples = $3, pages = $4,"
+								" widths = $5, ndistinct = $6, last_update = pg_catalog.now()"
+								" WHERE relid OPERATOR(pg_catalog.=) $1",
+								nspname, CATALOG_GLOBAL_TEMP_STATS),
+								6, argtypes, args, NULL, false, 0);
+		else
+			SPI_execute_with_args(psprintf("INSERT INTO %s.%s (relid, samples, tuples, pages, widths, ndistinct, last_update)"
+								" VALUES ($1, $2, $3, $4, $5, $6, pg_catalog.now()) ON CONFLICT (relid) DO NOTHING",
+								nspname, CATALOG_GLOBAL_TEMP_STATS),
+								6, argtypes, args, NULL, false, 0);
+
+		SPI_finish();
+
+		SetUserIdAndSecContext(save_userid, save_sec_context);
+		ReleaseCurrentSubTransaction();
+		MemoryContextSwitchTo(oldcontext);
+		CurrentResourceOwner = oldowner;
+
+		elog(DEBUG1, "statistics of temporary table with Oid %d published", srel->temp_relid);
+	}
+	PG_CATCH();
+	{
+		ErrorData  *edata;
+
+		MemoryContextSwitchTo(oldcontext);
+		edata = CopyErrorData();
+		FlushErrorState();
+
+		RollbackAndReleaseCurrentSubTransaction();
+		MemoryContextSwitchTo(oldcontext);
+		CurrentResourceOwner = oldowner;
+		SetUserIdAndSecContext(save_userid, save_sec_context);
+
+		elog(DEBUG1, "could not publish the statistics of temporary table with Oid %d: %s",
+					srel->temp_relid, edata->message);
+		FreeErrorData(edata);
+	}
+	PG_END_TRY();
+}
+
+/*
+ * Create the empty row of the statistics learned for a new GTT, the
+ * sessions only have to update it, or remove the row of a GTT that is
+ * dropped. This is done as the owner of the table, the owner of the GTT
+ * may not be allowed to write to it.
+ */
+static void
+gtt_learned_statistics_row(Oid relid, bool create)
+{
+	Oid         statsrelid = gtt_learned_stats_relid();
+	Oid         statsowner;
+	HeapTuple   reltup;
+	Oid         save_userid;
+	int         save_sec_context;
+	Oid         argtypes[1] = { OIDOID };
+	Datum       args[1];
+	char       *query;
+
+	if (!OidIsValid(statsrelid))
+		return;
+
+	reltup = SearchSysCache1(RELOID, ObjectIdGetDatum(statsrelid));
+	if (!HeapTupleIsValid(reltup))
+		return;
+	statsowner = ((Form_pg_class) GETSTRUCT(reltup))->relowner;
+	ReleaseSysCache(reltup);
+
+	if (create)
+		query = psprintf("INSERT INTO %s.%s (relid, samples, tuples, pages) VALUES ($1, 0, 0, 0)",
+						quote_identifier(pgtt_namespace_name), CATALOG_GLOBAL_TEMP_STATS);
+	else
+		query = psprintf("DELETE FROM %s.%s WHERE relid OPERATOR(pg_catalog.=) $1",
+						quote_identifier(pgtt_namespace_name), CATALOG_GLOBAL_TEMP_STATS);
+	args[0] = ObjectIdGetDatum(relid);
+
+	/* the user id is restored by the abort of the transaction on error */
+	GetUserIdAndSecContext(&save_userid, &save_sec_context);
+	SetUserIdAndSecContext(statsowner,
+						save_sec_context | SECURITY_LOCAL_USERID_CHANGE
+						| SECURITY_RESTRICTED_OPERATION);
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+		ereport(ERROR, (errmsg("could not connect to SPI manager")));
+
+	if (SPI_execute_with_args(query, 1, argtypes, args, NULL, false, 0) < 0)
+		ereport(ERROR, (errmsg("execution failure on query: \"%s\"", query)));
+
+	if (SPI_finish() != SPI_OK_FINISH)
+		ereport(ERROR, (errmsg("could not disconnect from SPI manager")));
+
+	SetUserIdAndSecContext(save_userid, save_sec_context);
+}
+
+/*
+ * Remove a temporary table from the session state.
+ */
+static void
+gtt_forget_session_rel(Oid temp_relid)
+{
+	GttSessionRel *srel;
+
+	if (GttSessionRelTable == NULL)
+		return;
+
+	srel = (GttSessionRel *) hash_search(GttSessionRelTable,
+									&temp_relid, HASH_FIND, NULL);
+	if (srel == NULL)
+		return;
+
+	if (srel->prior_widths != NULL)
+		pfree(srel->prior_widths);
+	if (srel->prior_ndistinct != NULL)
+		pfree(srel->prior_ndistinct);
+	if (srel->over_budget)
+		gtt_release_pending = true;
+	hash_search(GttSessionRelTable, &temp_relid, HASH_REMOVE, NULL);
+}
+
+/*
+ * Planner hook: give the number of distinct values learned from the other
+ * sessions for the columns of a temporary table that has no statistics.
+ */
+static bool
+gtt_get_relation_stats(PlannerInfo *root, RangeTblEntry *rte,
+					AttrNumber attnum, VariableStatData *vardata)
+{
+	GttSessionRel *srel;
+	Relation       statrel;
+	Datum          values[Natts_pg_statistic];
+	bool           nulls[Natts_pg_statistic];
+	int            i;
+
+	if (prev_get_relation_stats && prev_get_relation_stats(root, rte, attnum, vardata))
+		return true;
+
+	if (!pgtt_is_enabled || !pgtt_learn_statistics || GttSessionRelTable == NULL
+			|| rte->rtekind != RTE_RELATION || rte->inh || attnum <= 0)
+		return false;
+
+	srel = (GttSessionRel *) hash_search(GttSessionRelTable,
+									&rte->relid, HASH_FIND, NULL);
+	if (srel == NULL || attnum > srel->prior_natts
+			|| srel->prior_ndistinct[attnum - 1] == 0)
+		return false;
+
+	/* The statistics of the temporary table are always preferred */
+	if (SearchSysCacheExists3(STATRELATTINH, ObjectIdGetDatum(rte->relid),
+							Int16GetDatum(attnum), BoolGetDatum(false)))
+		return false;
+
+	/* Build a pg_statistic tuple without MCV or histogram */
+	memset(values, 0, sizeof(values));
+	memset(nulls, false, sizeof(nulls));
+	values[Anum_pg_statistic_starelid - 1] = ObjectIdGetDatum(rte->relid);
+	values[Anum_pg_statistic_staattnum - 1] = Int16GetDatum(attnum);
+	values[Anum_pg_statistic_stainherit - 1] = BoolGetDatum(false);
+	values[Anum_pg_statistic_stanullfrac - 1] = Float4GetDatum(0);
+	values[Anum_pg_statistic_stawidth - 1] = Int32GetDatum(srel->prior_widths[attnum - 1]);
+	values[Anum_pg_statistic_stadistinct - 1] = Float4GetDatum(srel->prior_ndistinct[attnum - 1]);
+	for (i = 0; i < STATISTIC_NUM_SLOTS; i++)
+	{
+		values[Anum_pg_statistic_stakind1 - 1 + i] = Int16GetDatum(0);
+		values[Anum_pg_statistic_staop1 - 1 + i] = ObjectIdGetDatum(InvalidOid);
+		values[Anum_pg_statistic_stacoll1 - 1 + i] = ObjectIdGetDatum(InvalidOid);
+		nulls[Anum_pg_statistic_stanumbers1 - 1 + i] = true;
+		nulls[Anum_pg_statistic_stavalues1 - 1 + i] = true;
+	}
+
+	statrel = table_open(StatisticRelationId, AccessShareLock);
+	vardata->statsTuple = heap_form_tuple(RelationGetDescr(statrel), values, nulls);
+	table_close(statrel, AccessShareLock);
+	vardata->freefunc = heap_freetuple;
+	/* the user owns the temporary table */
+	vardata->acl_ok = true;
+
+	return true;
+}
+
+/*
+ * Planner hook: give the average width learned from the other sessions for
+ * the columns of a temporary table that has no statistics.
+ */
+static int32
+gtt_get_attavgwidth(Oid relid, AttrNumber attnum)
+{
+	GttSessionRel *srel;
+
+	if (prev_get_attavgwidth)
+	{
+		int32 width = prev_get_attavgwidth(relid, attnum);
+
+		if (width > 0)
+			return width;
+	}
+
+	if (!pgtt_is_enabled || !pgtt_learn_statistics || GttSessionRelTable == NULL || attnum <= 0)
+		return 0;
+
+	srel = (GttSessionRel *) hash_search(GttSessionRelTable,
+									&relid, HASH_FIND, NULL);
+	if (srel == NULL || attnum > srel->prior_natts || srel->prior_widths[attnum - 1] <= 0)
+		return 0;
+
+	if (SearchSysCacheExists3(STATRELATTINH, ObjectIdGetDatum(relid),
+							Int16GetDatum(attnum), BoolGetDatum(false)))
+		return 0;
+
+	return srel->prior_widths[attnum - 1];
+}
+
+/*
+ * Register in the session state the temporary table just created for
+ * a GTT. The per GTT analyze thresholds are read from the autovacuum
+ * storage parameters of the "template" table, they are not used by
+ * autovacuum on the template which is always empty.
+ */
+static void
+gtt_register_session_rel(Relation parent_rel, Oid temp_relid,
+					bool preserved, bool tuples_valid)
+{
+	GttSessionRel *srel;
+
+	if (GttSessionRelTable == NULL)
+	{
+		HASHCTL         ctl;
+
+		MemSet(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(Oid);
+		ctl.entrysize = sizeof(GttSessionRel);
+		ctl.hcxt = CacheMemoryContext;
+		GttSessionRelTable = hash_create("Global Temporary Table session state",
+									GTT_PER_DATABASE,
+									&ctl,
+									HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	srel = (GttSessionRel *) hash_search(GttSessionRelTable,
+									&temp_relid, HASH_ENTER, NULL);
+	srel->relid = RelationGetRelid(parent_rel);
+	srel->auto_analyze = true;
+	srel->analyze_threshold = -1;
+	srel->analyze_scale_factor = -1;
+	srel->changes_since_analyze = 0;
+	srel->tuples_at_analyze = 0;
+	srel->preserved = preserved;
+	srel->tuples_valid = tuples_valid;
+	srel->tuples = 0;
+	/* a rollback will remove the temporary table created in this transaction */
+	srel->xact_tuples_valid = false;
+	srel->xact_tuples = 0;
+	srel->xact_changed = true;
+	srel->prior_density = 0;
+	srel->prior_natts = 0;
+	srel->prior_widths = NULL;
+	srel->prior_ndistinct = NULL;
+	srel->xact_inserted = 0;
+	srel->inserted_since_vacuum = 0;
+	srel->vm_pending = false;
+	srel->vm_used = false;
+	srel->vm_next_block = 0;
+	srel->ddl_pending = false;
+	srel->expected_rows = -1;
+	srel->template_sig = gtt_template_signature(parent_rel);
+	srel->sync_failed = false;
+	srel->failed_sig = 0;
+	srel->failed_with_rows = false;
+	srel->lazy_toast = false;
+	srel->bound = false;
+	srel->xact_bound = false;
+	srel->last_used = ++gtt_use_clock;
+	srel->xact_used = true;
+	srel->evicted = false;
+	srel->evicted_subid = InvalidSubTransactionId;
+	srel->buffer_budget = -1;
+	srel->over_budget = false;
+	srel->seeded = false;
+
+	if (parent_rel->rd_options != NULL)
+	{
+		StdRdOptions *opts = (StdRdOptions *) parent_rel->rd_options;
+
+		srel->auto_analyze = opts->autovacuum.enabled;
+		srel->analyze_threshold = opts->autovacuum.analyze_threshold;
+		srel->analyze_scale_factor = opts->autovacuum.analyze_scale_factor;
+	}
+}
+
+static bool
+gtt_table_exists(QueryDesc *queryDesc)
+{
+	bool    is_gtt = false;
+	char    *name = NULL;
+	char    relpersistence;
+	RangeTblEntry *rte;
+	Relation      rel;
+	Gtt           gtt;
+	PlannedStmt *pstmt = (PlannedStmt *) queryDesc->plannedstmt;
+
+	if (GttHashTable == NULL || !pstmt)
+		return false;
+
+	/* no relation in rtable probably a function call */
+	if (list_length(pstmt->rtable) == 0)
+		return false;
+
+	/* This must be a valid relation and not a temporary table */
+	rte = (RangeTblEntry *) linitial(pstmt->rtable);
+	if (rte->relid != InvalidOid && rte->relkind == RELKIND_RELATION
+				&& !is_catalog_relid(rte->relid))
+	{
+#if (PG_VERSION_NUM >= 120000)
+		rel = table_open(rte->relid, NoLock);
+#else
+		rel = heap_open(rte->relid, NoLock);
+#endif
+		name = RelationGetRelationName(rel);
+		relpersistence = rel->rd_rel->relpersistence;
+#if (PG_VERSION_NUM >= 120000)
+		table_close(rel, NoLock);
+#else
+		heap_close(rel, NoLock);
+#endif
+
+		/* Do not go further with temporary tables, catalog or toast table */
+		if (relpersistence != RELPERSISTENCE_TEMP)
+			return false;
+
+		gtt.relid = 0;
+		gtt.temp_relid = 0;
+		gtt.relname[0] = '\0';
+		gtt.preserved = false;
+		gtt.code = NULL;
+		gtt.created = false;
+		gtt.seeded = false;
+
+		/* Check if the table is in the hash list and it has not already be created */
+		if ((const void*)name != NULL)
+			GttHashTableLookup(name, gtt);
+
+		elog(DEBUG1, "gtt_table_exists() looking for table \"%s\" with relid %d into cache.", name, rte->relid);
+		if (gtt.relname[0] != '\0')
+		{
+			elog(DEBUG1, "GTT found in cache with name: %s, relid: %d, temp_relid %d", gtt.relname, gtt.relid, gtt.temp_relid);
+			/* Create the temporary table if it does not exists */
+			if (!gtt.created)
+			{
+				ParseState *pstate = make_parsestate(NULL);
+
+				elog(DEBUG1, "global temporary table does not exists create it: %s", gtt.relname);
+				/* Call create temporary table */
+				if ((gtt.temp_relid = create_temporary_table_internal(pstate, gtt.relid, gtt.preserved, false, true)) != InvalidOid)
+				{
+					elog(DEBUG1, "global temporary table %s (oid: %d) created", gtt.relname, gtt.temp_relid);
+					/* Update hash list with table flagged as created */
+					gtt.created = true;
+					GttHashTableDelete(gtt.relname);
+					GttHashTableInsert(gtt, gtt.relname);
+					free_parsestate(pstate);
+				}
+				else
+					elog(ERROR, "can not create global temporary table %s", gtt.relname);
+			}
+			is_gtt = true;
+		}
+		else
+			/* the table is not a global temporary table do nothing*/
+			elog(DEBUG1, "table \"%s\" not registered as GTT", name);
+	}
+
+	return is_gtt;
+}
+
+static bool
+is_declared_gtt(Oid relid)
+{
+	char    *name = NULL;
+	char    relpersistence;
+	Relation      rel;
+	Gtt           gtt;
+
+	if (GttHashTable == NULL)
+		return false;
+
+	/* This must be a valid relation and not a temporary table */
+	if (relid != InvalidOid && !is_catalog_relid(relid))
+	{
+#if (PG_VERSION_NUM >= 120000)
+		rel = table_open(relid, NoLock);
+#else
+		rel = heap_open(relid, NoLock);
+#endif
+		name = RelationGetRelationName(rel);
+		relpersistence = rel->rd_rel->relpersistence;
+#if (PG_VERSION_NUM >= 120000)
+		table_close(rel, NoLock);
+#else
+		heap_close(rel, NoLock);
+#endif
+
+		/* Do not go further with temporary tables, catalog or toast table */
+		if (relpersistence != RELPERSISTENCE_TEMP)
+			return false;
+
+		/* Check if the table is in the hash list and it has not already be created */
+		gtt.relid = 0;
+		gtt.temp_relid = 0;
+		gtt.relname[0] = '\0';
+		gtt.preserved = false;
+		gtt.code = NULL;
+		gtt.created = false;
+		gtt.seeded = false;
+
+		if ((const void*)name != NULL)
+			GttHashTableLookup(name, gtt);
+
+		if (gtt.relname[0] != '\0')
+			return true;
+	}
+
+	return false;
+}
+
+
+int
+strpos(char *hay, char *needle, int offset)
+{
+	char *haystack;
+	char *p;
+
+	haystack = (char *) malloc(strlen(hay));
+	if (haystack == NULL)
+	{
+		fprintf(stderr, "out of memory\n");
+		exit(EXIT_FAILURE);
+		return -1;
+	}
+	memset(haystack, 0, strlen(hay));
+
+	strncpy(haystack, hay+offset, strlen(hay)-offset);
+	p = strstr(haystack, needle);
+	if (p)
+		return p - haystack+offset;
+
+	return -1;
+}
+
+/*
+ * Create the Global Temporary Table with all associated objects
+ * by creating the template table and register the GTT in the
+ * pg_global_temp_tables table.
+ *
+ * When stmt is not NULL the "template" table is created from this
+ * statement instead of the code of the GTT, this is the case of
+ * the partitioned tables and of the partitions.
+ */
+static Oid
+gtt_create_table_statement(Gtt gtt, CreateStmt *stmt)
+{
+	char    *newQueryString = NULL;
+	int     connected = 0;
+	int     finished = 0;
+	int     result = 0;
+	Oid     gttOid = InvalidOid;
+	Datum   oidDatum;
+	bool    isnull;
+
+	elog(DEBUG1, "proceeding to Global Temporary Table creation.");
+
+	connected = SPI_connect();
+	if (connected != SPI_OK_CONNECT)
+		ereport(ERROR, (errmsg("could not connect to SPI manager")));
+
+	/* Create the "template" table */
+	if (stmt != NULL)
+	{
+		gtt_exec_utility_subcommand((Node *) stmt, "PGTT provide a query string");
+		CommandCounterIncrement();
+	}
+	else
+	{
+		newQueryString = psprintf("CREATE UNLOGGED TABLE %s.%s (%s)",
+				quote_identifier(pgtt_namespace_name),
+				quote_identifier(gtt.relname),
+				gtt.code);
+		result = SPI_exec(newQueryString, 0);
+		if (result < 0)
+			ereport(ERROR, (errmsg("execution failure on query: \"%s\"", newQueryString)));
+	}
+
+	/*
+	 * Get Oid of the newly created table, a partitioned table has
+	 * no relfilenode.
+	 */
+	newQueryString = psprintf("SELECT c.oid FROM pg_class c JOIN pg_namespace n ON (c.relnamespace=n.oid) WHERE c.relname=%s AND n.nspname = %s",
+			quote_literal_cstr(gtt.relname),
+			quote_literal_cstr(pgtt_namespace_name));
+
+	result = SPI_exec(newQueryString, 0);
+	if (result != SPI_OK_SELECT && SPI_processed != 1)
+		ereport(ERROR, (errmsg("execution failure on query: \"%s\"", newQueryString)));
+
+	oidDatum = SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 1, &isnull);
+
+	if (!isnull)
+		gttOid = DatumGetInt32(oidDatum);
+
+	if (isnull || !OidIsValid(gttOid))
+		ereport(ERROR,
+				(errmsg("can not get OID of newly created GTT template table %s",
+							quote_identifier(gtt.relname))));
+
+	/* Now register the GTT table */
+	newQueryString = psprintf("INSERT INTO %s.pg_global_temp_tables VALUES (%d, %s, %s, '%c', %s)",
+			quote_identifier(pgtt_namespace_name),
+			gttOid,
+			quote_literal_cstr(pgtt_namespace_name),
+			quote_literal_cstr(gtt.relname),
+			(gtt.preserved) ? 't' : 'f',
+			quote_literal_cstr(gtt.code)
+		);
+	result = SPI_exec(newQueryString, 0);
+	if (result < 0)
+		ereport(ERROR, (errmsg("can not registrer new global temporary table")));
+	gtt_learned_statistics_row(gttOid, true);
+
+	/*
+	 * Set privilege on the unlogged table. Only SELECT is granted to
+	 * PUBLIC here (previously ALL was granted, which let any role
+	 * INSERT/UPDATE/DELETE/TRUNCATE data in this table, and attach
+	 * triggers to it, regardless of ownership). SELECT is kept so the
+	 * documented "SET pgtt.enabled TO off; SELECT * FROM <schema>.<t>"
+	 * diagnostic pattern keeps working for any role.
+	 */
+	newQueryString = psprintf("GRANT SELECT ON TABLE %s.%s TO public",
+			quote_identifier(pgtt_namespace_name),
+			quote_identifier(gtt.relname));
+	result = SPI_exec(newQueryString, 0);
+	if (result < 0)
+		ereport(ERROR, (errmsg("execution failure on query: \"%s\"", newQueryString)));
+
+
+	/* Mark the GTT as been created before register the table in the cache */
+	gtt.created = true;
+
+	finished = SPI_finish();
+	if (finished != SPI_OK_FINISH)
+		ereport(ERROR, (errmsg("could not disconnect from SPI manager")));
+
+	return gttOid;
+}
+
+/*
+ * Unregister a Global Temporary Table in pg_global_temp_tables table
+ * using his relid.
+ */
+static void
+gtt_unregister_global_temporary_table(const char *relname)
+{
+	RangeVar     *rv;
+	Relation      rel;
+	ScanKeyData   key[1];
+	SysScanDesc   scan;
+	HeapTuple     tuple;
+
+	elog(DEBUG1, "Looking for registered GTT relname = %s", relname);
+
+	/* Set and open the GTT relation */
+	rv = makeRangeVar(pgtt_namespace_name, CATALOG_GLOBAL_TEMP_REL, -1);
+#if (PG_VERSION_NUM >= 120000)
+	rel = table_openrv(rv, RowExclusiveLock);
+#else
+	rel = heap_openrv(rv, RowExclusiveLock);
+#endif
+	/* Define scanning */
+	ScanKeyInit(&key[0], Anum_pgtt_relname, BTEqualStrategyNumber, F_NAMEEQ, CStringGetDatum(relname));
+
+	/* Start search of relation */
+	scan = systable_beginscan(rel, 0, true, NULL, 1, key);
+	/* Remove the tuples. */
+	while (HeapTupleIsValid(tuple = systable_getnext(scan)))
+	{
+		elog(DEBUG1, "removing tuple with relname = %s", relname);
+		simple_heap_delete(rel, &tuple->t_self);
+	}
+	/* Cleanup. */
+	systable_endscan(scan);
+#if (PG_VERSION_NUM >= 120000)
+	table_close(rel, RowExclusiveLock);
+#else
+	heap_close(rel, RowExclusiveLock);
+#endif
+}
+
+/*
+ * Unregister a Global Temporary Table in pg_global_temp_tables table
+ * that is not cached and using his name only.
+ */
+static void
+gtt_unregister_gtt_not_cached(const char *relname)
+{
+	RangeVar     *rv;
+	Relation      rel;
+	ScanKeyData   key[1];
+	SysScanDesc   scan;
+	HeapTuple     tuple;
+
+	elog(DEBUG1, "Looking for registered GTT relname = %s", relname);
+
+	/* Set and open the GTT relation */
+	rv = makeRangeVar(pgtt_namespace_name, CATALOG_GLOBAL_TEMP_REL, -1);
+#if (PG_VERSION_NUM >= 120000)
+	rel = table_openrv(rv, RowExclusiveLock);
+#else
+	rel = heap_openrv(rv, RowExclusiveLock);
+#endif
+	/* Define scanning */
+	ScanKeyInit(&key[0], Anum_pgtt_relname, BTEqualStrategyNumber, F_NAMEEQ, CStringGetDatum(relname));
+
+	/* Start search of relation */
+	scan = systable_beginscan(rel, 0, true, NULL, 1, key);
+	/*
+	 * Remove the tuples, but only those the current user is actually
+	 * allowed to drop. Previously this deleted any matching row
+	 * unconditionally, before PostgreSQL's own ownership check on the
+	 * subsequent DROP TABLE ever ran -- letting any authenticated role
+	 * deregister another user's Global Temporary Table simply by
+	 * naming it in a DROP TABLE statement, even though that statement
+	 * would itself go on to fail with a permission error.
+	 */
+	while (HeapTupleIsValid(tuple = systable_getnext(scan)))
+	{
+		bool  isnull;
+		Datum relidDatum = heap_getattr(tuple, Anum_pgtt_relid, RelationGetDescr(rel), &isnull);
+
+		if (isnull || !gtt_current_user_can_drop(DatumGetInt32(relidDatum)))
+		{
+			systable_endscan(scan);
+#if (PG_VERSION_NUM >= 120000)
+			table_close(rel, RowExclusiveLock);
+#else
+			heap_close(rel, RowExclusiveLock);
+#endif
+			ereport(ERROR,
+					(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+					 errmsg("must be owner of Global Temporary Table \"%s\" to drop it", relname)));
+		}
+
+		elog(DEBUG1, "removing tuple with relname = %s", relname);
+		simple_heap_delete(rel, &tuple->t_self);
+	}
+
+	/* Cleanup. */
+	systable_endscan(scan);
+#if (PG_VERSION_NUM >= 120000)
+	table_close(rel, RowExclusiveLock);
+#else
+	heap_close(rel, RowExclusiveLock);
+#endif
+}
+
+/*
+ * Check if pgtt hasn't been loaded yet, and try to load it in that case.
+ */
+static void
+gtt_try_load(void)
+{
+	/*
+	 * Don't try to load if the extension is disabled, if we can't do it now or
+	 * if it's already loaded.
+	 */
+	if (!pgtt_is_enabled || !IsTransactionState() || GttHashTable != NULL)
+		return;
+
+	/* Initialize list of Global Temporary Table */
+	if (EnableGttManager())
+	{
+		/*
+		 * Load temporary table definition from pg_global_temp_tables table
+		 * into our Hash table and pre-create the temporary tables.
+		 */
+		gtt_load_global_temporary_tables();
+
+		/*
+		 * Be sure that extension schema is at end of the search path so that
+		 * "template" tables will be found.
+		 */
+		force_pgtt_namespace();
+	}
+}
+
+#if PG_VERSION_NUM < 160000
+/*
+ * From src/backend/commands/extension.c
+ */
+Oid
+get_extension_schema(Oid ext_oid)
+{
+	Oid                     result;
+	Relation        rel;
+	SysScanDesc scandesc;
+	HeapTuple       tuple;
+	ScanKeyData entry[1];
+
+#if (PG_VERSION_NUM >= 120000)
+	rel = table_open(ExtensionRelationId, AccessShareLock);
+#else
+	rel = heap_open(ExtensionRelationId, AccessShareLock);
+#endif
+
+	ScanKeyInit(&entry[0],
+#if (PG_VERSION_NUM >= 120000)
+				Anum_pg_extension_oid,
+#else
+				ObjectIdAttributeNumber,
+#endif
+				BTEqualStrategyNumber, F_OIDEQ,
+				ObjectIdGetDatum(ext_oid));
+
+	scandesc = systable_beginscan(rel, ExtensionOidIndexId, true,
+								  NULL, 1, entry);
+
+	tuple = systable_getnext(scandesc);
+
+	/* We assume that there can be at most one matching tuple */
+	if (HeapTupleIsValid(tuple))
+		result = ((Form_pg_extension) GETSTRUCT(tuple))->extnamespace;
+	else
+		result = InvalidOid;
+
+	systable_endscan(scandesc);
+
+#if (PG_VERSION_NUM >= 120000)
+	table_close(rel, AccessShareLock);
+#else
+	heap_close(rel, AccessShareLock);
+#endif
+
+	return result;
+}
+#endif
+
+
+/*
+ * EnableGttManager
+ *              Enables the GTT management cache at backend startup.
+ */
+bool
+EnableGttManager(void)
+{
+	Oid extOid = get_extension_oid("pgtt", true);
+	RangeVar *rv;
+	char *nspname;
+
+	if (!OidIsValid(extOid))
+		return false;
+
+	pgtt_namespace_oid = get_extension_schema(extOid);
+	if (!OidIsValid(pgtt_namespace_oid))
+		elog(ERROR, "namespace %d can not be found.", pgtt_namespace_oid);
+
+	/*
+	 * Check if the GTT relation also exist. We might be in the middle of the
+	 * extension creation, where the line in pg_extension exists but not the
+	 * rest of SQL objects.
+	 */
+	nspname = get_namespace_name(pgtt_namespace_oid);
+	rv = makeRangeVar(nspname, CATALOG_GLOBAL_TEMP_REL, -1);
+
+	if (!OidIsValid(RangeVarGetRelid(rv, AccessShareLock, true)))
+		return false;
+
+	if (GttHashTable == NULL)
+	{
+		GttHashTable = gtt_create_hash_table(GTT_PER_DATABASE);
+		gtt_hash_free_entries = 0;
+		elog(DEBUG1, "GTT cache initialized.");
+	}
+
+	/*
+	 * Set the OID and name of the extension schema, all objects will be
+	 * created in this schema.
+	 */
+	strlcpy(pgtt_namespace_name, nspname, sizeof(pgtt_namespace_name));
+
+	return true;
+}
+
+/*
+ * Create the cache of the GTT in the cache context.
+ */
+static HTAB *
+gtt_create_hash_table(long nelem)
+{
+	HASHCTL         ctl;
+
+	MemSet(&ctl, 0, sizeof(ctl));
+	ctl.keysize = NAMEDATALEN;
+	ctl.entrysize = sizeof(GttHashEnt);
+
+	/* allocate GTT Cache in the cache context */
+	ctl.hcxt = CacheMemoryContext;
+	return hash_create("Global Temporary Table hash list",
+						nelem,
+						&ctl,
+#if PG_VERSION_NUM >= 140000
+						HASH_STRINGS | HASH_ELEM | HASH_CONTEXT
+#else
+						HASH_ELEM | HASH_CONTEXT
+#endif
+				);
+}
+
+/*
+ * The entries removed from a hash table are kept for reuse and its memory
+ * is never freed. When most of the entries of the cache of the GTT have
+ * been removed, the remaining ones are copied into a new cache and the
+ * memory of the old one is released. Must not be called during a scan of
+ * the cache.
+ */
+static void
+gtt_compact_hash_table(void)
+{
+	HTAB           *newtable;
+	HASH_SEQ_STATUS status;
+	GttHashEnt     *hentry;
+	long            live;
+
+	if (GttHashTable == NULL || gtt_hash_free_entries <= GTT_PER_DATABASE)
+		return;
+
+	live = hash_get_num_entries(GttHashTable);
+	if (gtt_hash_free_entries <= live)
+		return;
+
+	newtable = gtt_create_hash_table(Max(live, GTT_PER_DATABASE));
+
+	hash_seq_init(&status, GttHashTable);
+	while ((hentry = (GttHashEnt *) hash_seq_search(&status)) != NULL)
+	{
+		GttHashEnt *newentry;
+
+		newentry = (GttHashEnt *) hash_search(newtable, hentry->name, HASH_ENTER, NULL);
+		memcpy(newentry, hentry, sizeof(GttHashEnt));
+	}
+
+	elog(DEBUG1, "GTT cache compacted, %ld entries kept, %ld removed entries released",
+				live, gtt_hash_free_entries);
+
+	hash_destroy(GttHashTable);
+	GttHashTable = newtable;
+	gtt_hash_free_entries = 0;
+}
+
+/*
+ * Delete all declared Global Temporary Table.
+ *
+ */
+void
+GttHashTableDeleteAll(void)
+{
+	HASH_SEQ_STATUS status;
+	GttHashEnt *lentry = NULL;
+
+	if (GttHashTable == NULL)
+		return;
+
+	hash_seq_init(&status, GttHashTable);
+	while ((lentry = (GttHashEnt *) hash_seq_search(&status)) != NULL)
+	{
+		Gtt          gtt = GetGttByName(lentry->name);
+
+		elog(DEBUG1, "Remove GTT %s from our hash table", gtt.relname);
+		GttHashTableDelete(lentry->name);
+		/* Restart the iteration in case that led to other drops */
+		hash_seq_term(&status);
+		hash_seq_init(&status, GttHashTable);
+	}
+}
+
+/*
+ * GetGttByName
+ *       Returns a Gtt given a table name, or NULL if name is not found.
+ *
+ * Caller should have made sure that GTT has been properly loaded before
+ * calling this function.
+ */
+Gtt
+GetGttByName(const char *name)
+{
+	Gtt          gtt;
+
+	Assert(GttHashTable != NULL);
+
+	if ((const void*)name != NULL)
+		GttHashTableLookup(name, gtt);
+
+	return gtt;
+}
+
+/*
+ * Execute a utility statement generated by pgtt as a sub-command of the
+ * statement being processed.
+ */
+static void
+gtt_exec_utility_subcommand(Node *stmt, const char *querystring)
+{
+#if PG_VERSION_NUM >= 100000
+	PlannedStmt *pstmt = makeNode(PlannedStmt);
+
+	pstmt->commandType       = CMD_UTILITY;
+	pstmt->canSetTag         = true;
+	pstmt->utilityStmt       = stmt;
+	pstmt->stmt_location     = -1;
+	pstmt->stmt_len          = 0;
+	ProcessUtility(pstmt,
+					querystring,
+#if PG_VERSION_NUM >= 140000
+					false,
+#endif
+					PROCESS_UTILITY_SUBCOMMAND,
+					NULL, NULL,
+					None_Receiver,
+					NULL);
+#else
+	ProcessUtility(stmt,
+					querystring,
+					PROCESS_UTILITY_SUBCOMMAND,
+					NULL,
+					None_Receiver,
+					NULL);
+#endif
+}
+
+/*
+ * Definition of a trigger to be copied on the temporary table.
+ */
+typedef struct GttTriggerDef
+{
+	char   *def;			/* CREATE TRIGGER statement */
+	char   *tgname;			/* name of the trigger */
+	char    tgenabled;		/* tgenabled state on the "template" table */
+} GttTriggerDef;
+
+/*
+ * Restore on the temporary table the enabled state of a trigger when it
+ * is not the default one. pg_get_triggerdef() does not report the
+ * tgenabled state so the trigger is always created as ENABLE (fires on
+ * origin) and an ALTER TABLE sub-command is required to fix it.
+ */
+static void
+gtt_set_trigger_enabled(const char *relname, const char *tgname, char tgenabled)
+{
+	AlterTableStmt *atstmt;
+	AlterTableCmd  *atcmd;
+	const char     *action = NULL;
+
+	atcmd = makeNode(AlterTableCmd);
+
+	switch (tgenabled)
+	{
+		case TRIGGER_DISABLED:
+			atcmd->subtype = AT_DisableTrig;
+			action = "DISABLE TRIGGER";
+			break;
+		case TRIGGER_FIRES_ON_REPLICA:
+			atcmd->subtype = AT_EnableReplicaTrig;
+			action = "ENABLE REPLICA TRIGGER";
+			break;
+		case TRIGGER_FIRES_ALWAYS:
+			atcmd->subtype = AT_EnableAlwaysTrig;
+			action = "ENABLE ALWAYS TRIGGER";
+			break;
+		default:
+			/* TRIGGER_FIRES_ON_ORIGIN is the state set at creation time */
+			return;
+	}
+
+	atcmd->name = pstrdup(tgname);
+	atcmd->behavior = DROP_RESTRICT;
+	atcmd->missing_ok = false;
+
+	atstmt = makeNode(AlterTableStmt);
+	atstmt->relation = makeRangeVar("pg_temp", pstrdup(relname), -1);
+	atstmt->relation->relpersistence = RELPERSISTENCE_TEMP;
+	atstmt->cmds = list_make1(atcmd);
+	atstmt->missing_ok = false;
+	STMT_OBJTYPE(atstmt) = OBJECT_TABLE;
+
+	elog(DEBUG1, "restoring state of trigger \"%s\" on temporary table \"%s\": %s",
+			tgname, relname, action);
+
+	gtt_exec_utility_subcommand((Node *) atstmt, "PGTT provide a query string");
+	CommandCounterIncrement();
+}
+
+/*
+ * Copy on the temporary table the triggers defined on the "template"
+ * table of a global temporary table.
+ *
+ * CREATE TABLE ... (LIKE ...) has no INCLUDING TRIGGERS option in
+ * PostgreSQL, so the triggers must be replicated by hand once the
+ * temporary table has been created. The definition of each trigger is
+ * obtained through pg_get_triggerdef(), parsed back, and the relation
+ * of the resulting CreateTrigStmt is changed to point to the temporary
+ * table before being executed. The triggers that already exist on the
+ * temporary table are skipped.
+ *
+ * See https://github.com/darold/pgtt/issues/52
+ */
+static void
+gtt_copy_triggers(Oid parent_relid, Oid temp_relid, const char *relname)
+{
+	Relation      tgrel;
+	SysScanDesc   tgscan;
+	ScanKeyData   key;
+	HeapTuple     tuple;
+	List         *trigger_defs = NIL;
+	ListCell     *lc;
+
+	elog(DEBUG1, "looking for triggers to copy from relation with Oid %d", parent_relid);
+
+	/*
+	 * Collect the definition of all the triggers of the "template" table
+	 * first, the catalog scan must be closed before executing any DDL.
+	 */
+	tgrel = table_open(TriggerRelationId, AccessShareLock);
+
+	ScanKeyInit(&key,
+				Anum_pg_trigger_tgrelid,
+				BTEqualStrategyNumber, F_OIDEQ,
+				ObjectIdGetDatum(parent_relid));
+
+	tgscan = systable_beginscan(tgrel, TriggerRelidNameIndexId, true,
+								NULL, 1, &key);
+
+	while (HeapTupleIsValid(tuple = systable_getnext(tgscan)))
+	{
+		Form_pg_trigger  trigform = (Form_pg_trigger) GETSTRUCT(tuple);
+		GttTriggerDef   *trigdef;
+		Oid              trigoid;
+		Datum            def;
+
+		/*
+		 * Skip triggers created internally by PostgreSQL, they are built
+		 * again with the constraints and indexes copied by the LIKE clause.
+		 */
+		if (trigform->tgisinternal)
+			continue;
+#if (PG_VERSION_NUM >= 130000)
+		/* Cloned from a partitioned table, created again with its trigger */
+		if (OidIsValid(trigform->tgparentid))
+			continue;
+#endif
+
+		/* Already on the temporary table, see gtt_sync_session_rel() */
+		if (OidIsValid(get_trigger_oid(temp_relid, NameStr(trigform->tgname), true)))
+			continue;
+
+#if (PG_VERSION_NUM >= 120000)
+		trigoid = trigform->oid;
+#else
+		trigoid = HeapTupleGetOid(tuple);
+#endif
+
+#if (PG_VERSION_NUM < 140000)
+		def = OidFunctionCall1(F_PG_GET_TRIGGERDEF, ObjectIdGetDatum(trigoid));
+#else
+		def = OidFunctionCall1(F_PG_GET_TRIGGERDEF_OID, ObjectIdGetDatum(trigoid));
+#endif
+
+		trigdef = (GttTriggerDef *) palloc0(sizeof(GttTriggerDef));
+		trigdef->def = TextDatumGetCString(def);
+		trigdef->tgname = pstrdup(NameStr(trigform->tgname));
+		trigdef->tgenabled = trigform->tgenabled;
+
+		trigger_defs = lappend(trigger_defs, trigdef);
+	}
+
+	systable_endscan(tgscan);
+	table_close(tgrel, AccessShareLock);
+
+	if (trigger_defs == NIL)
+		return;
+
+	/* The temporary table must be visible before adding the triggers */
+	CommandCounterIncrement();
+
+	foreach (lc, trigger_defs)
+	{
+		GttTriggerDef *trigdef = (GttTriggerDef *) lfirst(lc);
+		List          *raw_parsetree_list;
+		ListCell      *lc2;
+
+		elog(DEBUG1, "copying trigger on temporary table: %s", trigdef->def);
+
+#if (PG_VERSION_NUM >= 140000)
+		raw_parsetree_list = raw_parser(trigdef->def, RAW_PARSE_DEFAULT);
+#else
+		raw_parsetree_list = raw_parser(trigdef->def);
+#endif
+
+		foreach (lc2, raw_parsetree_list)
+		{
+			CreateTrigStmt *trigstmt;
+#if (PG_VERSION_NUM >= 100000)
+			Node *parsetree = ((RawStmt *) lfirst(lc2))->stmt;
+#else
+			Node *parsetree = (Node *) lfirst(lc2);
+#endif
+
+			if (!IsA(parsetree, CreateTrigStmt))
+				continue;
+
+			trigstmt = (CreateTrigStmt *) parsetree;
+
+			/* Redirect the trigger creation to the temporary table */
+			trigstmt->relation = makeRangeVar("pg_temp", pstrdup(relname), -1);
+			trigstmt->relation->relpersistence = RELPERSISTENCE_TEMP;
+
+			gtt_exec_utility_subcommand(parsetree, trigdef->def);
+			CommandCounterIncrement();
+		}
+
+		/*
+		 * The trigger is always created enabled, restore the state it has
+		 * on the "template" table when it is a different one.
+		 */
+		gtt_set_trigger_enabled(relname, trigdef->tgname, trigdef->tgenabled);
+	}
+}
+
+/*
+ * Relcache invalidation callback: the "template" table of an instantiated
+ * GTT has been changed by this session or by another one. The catalogs
+ * can not be accessed here, the temporary tables are only flagged and
+ * synchronized by gtt_sync_pending_tables() before the next statement.
+ */
+static void
+gtt_relcache_callback(Datum arg, Oid relid)
+{
+	HASH_SEQ_STATUS status;
+	GttSessionRel  *srel;
+
+	/* An option of a GTT has been changed, see pgtt_set_option() */
+	if (!OidIsValid(relid) || (OidIsValid(gtt_registry_relid) && relid == gtt_registry_relid))
+		gtt_seeded_pending = true;
+
+	if (GttSessionRelTable == NULL)
+		return;
+
+	hash_seq_init(&status, GttSessionRelTable);
+	while ((srel = (GttSessionRel *) hash_seq_search(&status)) != NULL)
+	{
+		if (!OidIsValid(relid) || srel->relid == relid)
+		{
+			srel->ddl_pending = true;
+			gtt_ddl_pending = true;
+		}
+	}
+}
+
+/*
+ * Signature of the definition of a "template" table: its pg_class row and
+ * the columns, indexes and triggers from its relcache entry. An
+ * invalidation that leaves it unchanged, like the reset of all the cache
+ * entries, does not need a synchronization of the temporary table.
+ */
+static pg_crc32c
+gtt_template_signature(Relation rel)
+{
+	TupleDesc       tupdesc = RelationGetDescr(rel);
+	HeapTuple       tuple;
+	TransactionId   xmin = InvalidTransactionId;
+	List           *indexes;
+	ListCell       *lc;
+	pg_crc32c       crc;
+	int             i;
+
+	INIT_CRC32C(crc);
+
+	tuple = SearchSysCache1(RELOID, ObjectIdGetDatum(RelationGetRelid(rel)));
+	if (HeapTupleIsValid(tuple))
+	{
+		xmin = HeapTupleHeaderGetRawXmin(tuple->t_data);
+		ReleaseSysCache(tuple);
+	}
+	COMP_CRC32C(crc, &xmin, sizeof(xmin));
+
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupdesc, i);
+
+		if (att->attisdropped)
+			continue;
+		COMP_CRC32C(crc, NameStr(att->attname), strlen(NameStr(att->attname)));
+		COMP_CRC32C(crc, &att->atttypid, sizeof(att->atttypid));
+		COMP_CRC32C(crc, &att->attstorage, sizeof(att->attstorage));
+		COMP_CRC32C(crc, &att->attnotnull, sizeof(att->attnotnull));
+		COMP_CRC32C(crc, &att->atthasdef, sizeof(att->atthasdef));
+#if PG_VERSION_NUM >= 140000
+		COMP_CRC32C(crc, &att->attcompression, sizeof(att->attcompression));
+#endif
+	}
+
+	indexes = RelationGetIndexList(rel);
+	foreach(lc, indexes)
+	{
+		Oid indexoid = lfirst_oid(lc);
+
+		COMP_CRC32C(crc, &indexoid, sizeof(indexoid));
+	}
+	list_free(indexes);
+
+	if (rel->trigdesc != NULL)
+	{
+		for (i = 0; i < rel->trigdesc->numtriggers; i++)
+		{
+			Trigger *trigger = &rel->trigdesc->triggers[i];
+
+			COMP_CRC32C(crc, &trigger->tgoid, sizeof(trigger->tgoid));
+			COMP_CRC32C(crc, &trigger->tgenabled, sizeof(trigger->tgenabled));
+		}
+	}
+
+	FIN_CRC32C(crc);
+
+	return crc;
+}
+
+/*
+ * Apply to the temporary tables of the session the changes made on their
+ * "template" table since they have been created: table renamed, columns
+ * added, indexes, constraints and triggers added or removed. Each table
+ * is synchronized in its own subtransaction, when a change can not be
+ * applied, for example a NOT NULL column without default added while the
+ * temporary table has rows, a warning is emitted once and the temporary
+ * table keeps its definition. The synchronization is retried when the
+ * "template" table is changed again or when the temporary table becomes
+ * empty.
+ */
+static void
+gtt_sync_pending_tables(void)
+{
+	HASH_SEQ_STATUS status;
+	GttSessionRel  *srel;
+	List           *relids = NIL;
+	List           *temp_relids = NIL;
+	List           *retries = NIL;
+	ListCell       *lc1;
+	ListCell       *lc2;
+	ListCell       *lc3;
+
+	if ((!gtt_ddl_pending && !gtt_ddl_failed) || gtt_in_ddl_sync
+			|| GttSessionRelTable == NULL)
+		return;
+
+	/* Subtransactions can not be started while in parallel mode */
+	if (!IsTransactionState() || IsInParallelMode())
+		return;
+
+	gtt_ddl_pending = false;
+	gtt_ddl_failed = false;
+
+	/* Collect first, the synchronization itself sends invalidations */
+	hash_seq_init(&status, GttSessionRelTable);
+	while ((srel = (GttSessionRel *) hash_seq_search(&status)) != NULL)
+	{
+		bool    retry = false;
+
+		/* The change may apply now that the temporary table is empty */
+		if (srel->sync_failed && srel->failed_with_rows)
+		{
+			if (GTT_KNOWN_EMPTY(srel))
+			{
+				srel->failed_with_rows = false;
+				retry = true;
+			}
+			else
+				gtt_ddl_failed = true;
+		}
+		if (!srel->ddl_pending && !retry)
+			continue;
+		srel->ddl_pending = false;
+		relids = lappend_oid(relids, srel->relid);
+		temp_relids = lappend_oid(temp_relids, srel->temp_relid);
+		retries = lappend_int(retries, retry);
+	}
+
+	forthree(lc1, relids, lc2, temp_relids, lc3, retries)
+	{
+		Oid            relid = lfirst_oid(lc1);
+		Oid            temp_relid = lfirst_oid(lc2);
+		bool           retry = (bool) lfirst_int(lc3);
+		MemoryContext  oldcontext = CurrentMemoryContext;
+		ResourceOwner  oldowner = CurrentResourceOwner;
+		char          *oldname = NULL;
+		bool           synced = false;
+		bool           failed_before = false;
+		bool           locked;
+		pg_crc32c      sig = 0;
+		Relation       rel;
+
+		/* Skip the comparison of the catalogs when nothing has changed */
+		locked = gtt_relation_locked_by_me(relid, AccessShareLock);
+		rel = try_relation_open(relid, AccessShareLock);
+		if (rel != NULL)
+		{
+			sig = gtt_template_signature(rel);
+			relation_close(rel, locked ? NoLock : AccessShareLock);
+			srel = (GttSessionRel *) hash_search(GttSessionRelTable,
+											&temp_relid, HASH_FIND, NULL);
+			if (srel != NULL && EQ_CRC32C(srel->template_sig, sig))
+			{
+				elog(DEBUG1, "template table with relid %u has not changed", relid);
+				srel->sync_failed = false;
+				continue;
+			}
+			failed_before = (srel != NULL && srel->sync_failed
+							 && EQ_CRC32C(srel->failed_sig, sig));
+			if (failed_before && !retry)
+			{
+				elog(DEBUG1, "changes of template table with relid %u already failed", relid);
+				continue;
+			}
+		}
+
+		BeginInternalSubTransaction(NULL);
+		MemoryContextSwitchTo(oldcontext);
+		gtt_in_ddl_sync = true;
+
+		PG_TRY();
+		{
+			oldname = gtt_sync_session_rel(relid, temp_relid);
+			synced = true;
+
+			ReleaseCurrentSubTransaction();
+			MemoryContextSwitchTo(oldcontext);
+			CurrentResourceOwner = oldowner;
+		}
+		PG_CATCH();
+		{
+			ErrorData  *edata;
+
+			MemoryContextSwitchTo(oldcontext);
+			edata = CopyErrorData();
+			FlushErrorState();
+
+			RollbackAndReleaseCurrentSubTransaction();
+			MemoryContextSwitchTo(oldcontext);
+			CurrentResourceOwner = oldowner;
+
+			if (!failed_before)
+				ereport(WARNING,
+						(errmsg("could not apply the changes of global temporary table with relid %d to its temporary table: %s",
+								relid, edata->message)));
+			else
+				elog(DEBUG1, "could not apply the changes of global temporary table with relid %d: %s",
+							relid, edata->message);
+			FreeErrorData(edata);
+		}
+		PG_END_TRY();
+		gtt_in_ddl_sync = false;
+
+		/*
+		 * Remember the definition applied, or the one that failed to not
+		 * try it again before a new change or until the table is empty.
+		 */
+		srel = (GttSessionRel *) hash_search(GttSessionRelTable,
+										&temp_relid, HASH_FIND, NULL);
+		if (srel != NULL)
+		{
+			if (synced)
+			{
+				srel->template_sig = sig;
+				srel->sync_failed = false;
+				srel->failed_with_rows = false;
+			}
+			else
+			{
+				srel->sync_failed = true;
+				srel->failed_sig = sig;
+				srel->failed_with_rows = !retry && !GTT_KNOWN_EMPTY(srel);
+				if (srel->failed_with_rows)
+					gtt_ddl_failed = true;
+			}
+		}
+
+		/* The temporary table has been renamed, follow it in the cache */
+		if (oldname != NULL)
+		{
+			char   *newname = get_rel_name(temp_relid);
+			Gtt     gtt;
+
+			gtt.relid = 0;
+			GttHashTableLookup(oldname, gtt);
+			if (gtt.relid != 0 && newname != NULL)
+			{
+				GttHashTableDelete(oldname);
+				strlcpy(gtt.relname, newname, sizeof(gtt.relname));
+				GttHashTableInsert(gtt, newname);
+			}
+		}
+	}
+}
+
+/*
+ * Synchronize the definition of a temporary table with its "template"
+ * table. The differences are computed from the catalogs, this makes the
+ * operation idempotent: the columns are matched by name, the indexes and
+ * the constraints by definition and the triggers by name. Columns removed
+ * from the "template" or whose type has changed are left untouched, the
+ * statements already analyzed in the session may still reference them.
+ *
+ * Return the previous name of the temporary table when it has been
+ * renamed, NULL otherwise.
+ */
+static char *
+gtt_sync_session_rel(Oid relid, Oid temp_relid)
+{
+	char       *relname;
+	char       *temp_relname;
+	char       *oldname = NULL;
+	char       *qualname;
+	const char *query;
+	bool        locked;
+	Oid         argtypes[3] = { OIDOID, OIDOID, TEXTOID };
+	Datum       args[3];
+	List       *ddls = NIL;
+	ListCell   *lc;
+	uint64      i;
+
+	/* Prevent concurrent changes of the "template" table */
+	locked = gtt_relation_locked_by_me(relid, AccessShareLock);
+	LockRelationOid(relid, AccessShareLock);
+
+	relname = get_rel_name(relid);
+	temp_relname = get_rel_name(temp_relid);
+
+	/* The GTT or the temporary table has been dropped meanwhile */
+	if (relname == NULL || temp_relname == NULL)
+	{
+		if (!locked)
+			UnlockRelationOid(relid, AccessShareLock);
+		return NULL;
+	}
+
+	elog(DEBUG1, "synchronizing temporary table \"%s\" with its template table \"%s\"",
+							temp_relname, relname);
+
+	/* Indexes are matched on the part of their definition after USING */
+#define GTT_NOT_CONSTRAINT_INDEX(i) \
+	"NOT EXISTS (SELECT 1 FROM pg_catalog.pg_constraint k WHERE k.conrelid = " i ".indrelid" \
+	" AND k.conindid = " i ".indexrelid AND k.contype IN ('p', 'u', 'x'))"
+#define GTT_INDEX_DEF(i) \
+	"substring(pg_catalog.pg_get_indexdef(" i ".indexrelid) from ' USING (.*)$')"
+	/*
+	 * The columns keep the same position on both tables, a column of the
+	 * temporary table whose name is no longer used by the "template" has
+	 * been renamed.
+	 */
+#define GTT_RENAMED_COLUMN(a) \
+	"SELECT r.attname FROM pg_catalog.pg_attribute r WHERE r.attrelid = $2" \
+	" AND r.attnum = " a ".attnum AND r.atttypid = " a ".atttypid AND NOT r.attisdropped" \
+	" AND NOT EXISTS (SELECT 1 FROM pg_catalog.pg_attribute o WHERE o.attrelid = $1" \
+	" AND o.attname = r.attname AND NOT o.attisdropped)"
+	/* Storage parameters of a table and of its TOAST table, as name=value */
+#define GTT_RELOPTIONS(r) \
+	"SELECT o FROM pg_catalog.pg_class c, pg_catalog.unnest(c.reloptions) o WHERE c.oid = " r \
+	" UNION ALL SELECT 'toast.' || o FROM pg_catalog.pg_class c JOIN pg_catalog.pg_class x" \
+	" ON (x.oid = c.reltoastrelid), pg_catalog.unnest(x.reloptions) o WHERE c.oid = " r
+
+	query = "SELECT ddl FROM ("
+		/* columns renamed on the "template" table */
+		" SELECT 0 AS step, a.attnum AS pos, pg_catalog.format('ALTER TABLE %s RENAME COLUMN %I TO %I', $3,"
+		"   (" GTT_RENAMED_COLUMN("a") "), a.attname) AS ddl"
+		"  FROM pg_catalog.pg_attribute a WHERE a.attrelid = $1 AND a.attnum > 0 AND NOT a.attisdropped"
+		"  AND NOT EXISTS (SELECT 1 FROM pg_catalog.pg_attribute b WHERE b.attrelid = $2"
+		"   AND b.attname = a.attname AND NOT b.attisdropped)"
+		"  AND EXISTS (" GTT_RENAMED_COLUMN("a") ")"
+		/* constraints removed from the "template" table */
+		" UNION ALL SELECT 1, 0, pg_catalog.format('ALTER TABLE %s DROP CONSTRAINT %I', $3, s.conname) AS ddl"
+		"  FROM pg_catalog.pg_constraint s WHERE s.conrelid = $2 AND s.contype IN ('c', 'p', 'u', 'x')"
+		"  AND NOT EXISTS (SELECT 1 FROM pg_catalog.pg_constraint t WHERE t.conrelid = $1"
+		"   AND t.contype = s.contype AND pg_catalog.pg_get_constraintdef(t.oid) = pg_catalog.pg_get_constraintdef(s.oid))"
+		/* indexes removed from the "template" table */
+		" UNION ALL SELECT 2, 0, pg_catalog.format('DROP INDEX pg_temp.%I', c.relname)"
+		"  FROM pg_catalog.pg_index s JOIN pg_catalog.pg_class c ON (c.oid = s.indexrelid)"
+		"  WHERE s.indrelid = $2 AND " GTT_NOT_CONSTRAINT_INDEX("s")
+		"  AND NOT EXISTS (SELECT 1 FROM pg_catalog.pg_index t WHERE t.indrelid = $1"
+		"   AND t.indisunique = s.indisunique AND " GTT_NOT_CONSTRAINT_INDEX("t")
+		"   AND " GTT_INDEX_DEF("t") " = " GTT_INDEX_DEF("s") ")"
+		/* triggers removed from the "template" table */
+		" UNION ALL SELECT 3, 0, pg_catalog.format('DROP TRIGGER %I ON %s', s.tgname, $3)"
+		"  FROM pg_catalog.pg_trigger s WHERE s.tgrelid = $2 AND NOT s.tgisinternal"
+		"  AND NOT EXISTS (SELECT 1 FROM pg_catalog.pg_trigger t WHERE t.tgrelid = $1 AND t.tgname = s.tgname)"
+		/* columns added to the "template" table */
+		" UNION ALL SELECT 4, a.attnum, pg_catalog.format('ALTER TABLE %s ADD COLUMN %I %s%s%s%s', $3, a.attname,"
+		"   pg_catalog.format_type(a.atttypid, a.atttypmod),"
+		"   coalesce((SELECT ' COLLATE ' || pg_catalog.quote_ident(n.nspname) || '.' || pg_catalog.quote_ident(l.collname)"
+		"    FROM pg_catalog.pg_collation l JOIN pg_catalog.pg_namespace n ON (n.oid = l.collnamespace)"
+		"    JOIN pg_catalog.pg_type y ON (y.oid = a.atttypid)"
+		"    WHERE l.oid = a.attcollation AND a.attcollation <> y.typcollation), ''),"
+		"   coalesce(CASE WHEN a.attgenerated = 's'"
+		"    THEN ' GENERATED ALWAYS AS (' || pg_catalog.pg_get_expr(d.adbin, d.adrelid) || ') STORED'"
+		"    ELSE ' DEFAULT ' || pg_catalog.pg_get_expr(d.adbin, d.adrelid) END, ''),"
+		"   CASE WHEN a.attnotnull THEN ' NOT NULL' ELSE '' END)"
+		"  FROM pg_catalog.pg_attribute a LEFT JOIN pg_catalog.pg_attrdef d ON (d.adrelid = a.attrelid AND d.adnum = a.attnum)"
+		"  WHERE a.attrelid = $1 AND a.attnum > 0 AND NOT a.attisdropped"
+		"  AND NOT EXISTS (SELECT 1 FROM pg_catalog.pg_attribute b WHERE b.attrelid = $2"
+		"   AND b.attname = a.attname AND NOT b.attisdropped)"
+		"  AND NOT EXISTS (" GTT_RENAMED_COLUMN("a") ")"
+		/* indexes added to the "template" table */
+		" UNION ALL SELECT 5, 0, pg_catalog.format('CREATE %sINDEX ON %s USING %s',"
+		"   CASE WHEN t.indisunique THEN 'UNIQUE ' ELSE '' END, $3, " GTT_INDEX_DEF("t") ")"
+		"  FROM pg_catalog.pg_index t WHERE t.indrelid = $1 AND " GTT_NOT_CONSTRAINT_INDEX("t")
+		"  AND NOT EXISTS (SELECT 1 FROM pg_catalog.pg_index s WHERE s.indrelid = $2"
+		"   AND s.indisunique = t.indisunique AND " GTT_NOT_CONSTRAINT_INDEX("s")
+		"   AND " GTT_INDEX_DEF("s") " = " GTT_INDEX_DEF("t") ")"
+		/* constraints added to the "template" table */
+		" UNION ALL SELECT 6, 0, pg_catalog.format('ALTER TABLE %s ADD CONSTRAINT %I %s', $3, t.conname,"
+		"   pg_catalog.pg_get_constraintdef(t.oid))"
+		"  FROM pg_catalog.pg_constraint t WHERE t.conrelid = $1 AND t.contype IN ('c', 'p', 'u', 'x')"
+		"  AND NOT EXISTS (SELECT 1 FROM pg_catalog.pg_constraint s WHERE s.conrelid = $2"
+		"   AND s.contype = t.contype AND pg_catalog.pg_get_constraintdef(s.oid) = pg_catalog.pg_get_constraintdef(t.oid))"
+		/* storage parameters removed from the "template" table */
+		" UNION ALL SELECT 7, 0, pg_catalog.format('ALTER TABLE %s RESET (%s)', $3,"
+		"   pg_catalog.string_agg(pg_catalog.split_part(s.o, '=', 1), ', '))"
+		"  FROM (" GTT_RELOPTIONS("$2") ") AS s (o)"
+		"  WHERE pg_catalog.split_part(s.o, '=', 1) NOT IN (SELECT pg_catalog.split_part(t.o, '=', 1)"
+		"   FROM (" GTT_RELOPTIONS("$1") ") AS t (o)) HAVING count(*) > 0"
+		/* storage parameters set on the "template" table */
+		" UNION ALL SELECT 8, 0, pg_catalog.format('ALTER TABLE %s SET (%s)', $3,"
+		"   pg_catalog.string_agg(pg_catalog.format('%s = %L', pg_catalog.split_part(t.o, '=', 1),"
+		"    pg_catalog.substr(t.o, pg_catalog.strpos(t.o, '=') + 1)), ', '))"
+		"  FROM (" GTT_RELOPTIONS("$1") ") AS t (o)"
+		"  WHERE t.o NOT IN (SELECT s.o FROM (" GTT_RELOPTIONS("$2") ") AS s (o)) HAVING count(*) > 0"
+		/* storage of the columns, the columns added above have the default of their type */
+		" UNION ALL SELECT 9, a.attnum, pg_catalog.format('ALTER TABLE %s ALTER COLUMN %I SET STORAGE %s', $3, a.attname,"
+		"   CASE a.attstorage WHEN 'p' THEN 'PLAIN' WHEN 'e' THEN 'EXTERNAL' WHEN 'm' THEN 'MAIN' ELSE 'EXTENDED' END)"
+		"  FROM pg_catalog.pg_attribute a JOIN pg_catalog.pg_type y ON (y.oid = a.atttypid)"
+		"  LEFT JOIN pg_catalog.pg_attribute b ON (b.attrelid = $2 AND b.attname = a.attname AND NOT b.attisdropped)"
+		"  WHERE a.attrelid = $1 AND a.attnum > 0 AND NOT a.attisdropped"
+		"  AND a.attstorage <> coalesce(b.attstorage, y.typstorage)"
+#if (PG_VERSION_NUM >= 140000)
+		" UNION ALL SELECT 10, a.attnum, pg_catalog.format('ALTER TABLE %s ALTER COLUMN %I SET COMPRESSION %s', $3, a.attname,"
+		"   CASE a.attcompression WHEN 'p' THEN 'pglz' WHEN 'l' THEN 'lz4' ELSE 'DEFAULT' END)"
+		"  FROM pg_catalog.pg_attribute a"
+		"  LEFT JOIN pg_catalog.pg_attribute b ON (b.attrelid = $2 AND b.attname = a.attname AND NOT b.attisdropped)"
+		"  WHERE a.attrelid = $1 AND a.attnum > 0 AND NOT a.attisdropped"
+		"  AND a.attcompression <> coalesce(b.attcompression, '')"
+#endif
+		") AS sync ORDER BY step, pos";
+
+#undef GTT_NOT_CONSTRAINT_INDEX
+#undef GTT_INDEX_DEF
+#undef GTT_RENAMED_COLUMN
+#undef GTT_RELOPTIONS
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+		ereport(ERROR, (errmsg("could not connect to SPI manager")));
+
+	/* The GTT has been renamed */
+	if (strcmp(relname, temp_relname) != 0)
+	{
+		elog(DEBUG1, "renaming temporary table \"%s\" into \"%s\"", temp_relname, relname);
+		if (SPI_exec(psprintf("ALTER TABLE pg_temp.%s RENAME TO %s",
+						quote_identifier(temp_relname),
+						quote_identifier(relname)), 0) != SPI_OK_UTILITY)
+			ereport(ERROR,
+					(errmsg("can not rename temporary table \"%s\"", temp_relname)));
+		oldname = temp_relname;
+	}
+
+	qualname = psprintf("pg_temp.%s", quote_identifier(relname));
+	args[0] = ObjectIdGetDatum(relid);
+	args[1] = ObjectIdGetDatum(temp_relid);
+	args[2] = CStringGetTextDatum(qualname);
+
+	if (SPI_execute_with_args(query, 3, argtypes, args, NULL, true, 0) != SPI_OK_SELECT)
+		ereport(ERROR,
+				(errmsg("can not compare temporary table \"%s\" with its template table", relname)));
+
+	for (i = 0; i < SPI_processed; i++)
+		ddls = lappend(ddls, SPI_getvalue(SPI_tuptable->vals[i], SPI_tuptable->tupdesc, 1));
+
+	foreach (lc, ddls)
+	{
+		char *ddl = (char *) lfirst(lc);
+
+		elog(DEBUG1, "applying change on temporary table: %s", ddl);
+		if (SPI_exec(ddl, 0) != SPI_OK_UTILITY)
+			ereport(ERROR, (errmsg("can not execute \"%s\"", ddl)));
+	}
+
+	if (SPI_finish() != SPI_OK_FINISH)
+		ereport(ERROR, (errmsg("could not disconnect from SPI manager")));
+
+	/* Triggers are copied from their definition, see issue #52 */
+	gtt_copy_triggers(relid, temp_relid, relname);
+	CommandCounterIncrement();
+
+	if (!locked)
+		UnlockRelationOid(relid, AccessShareLock);
+
+	return oldname;
+}
+
+/*
+ * Load Global Temporary Table in memory from pg_global_temp_tables table.
+ */
+static void
+gtt_load_global_temporary_tables(void)
+{
+	RangeVar       *rv;
+	Relation       rel;
+#if (PG_VERSION_NUM >= 120000)
+	TableScanDesc  scan;
+#else
+	HeapScanDesc   scan;
+#endif
+	HeapTuple     tuple;
+	int           numberOfAttributes;
+	TupleDesc     tupleDesc;
+	Snapshot      snapshot;
 
-	if (GttHashTable == NULL || !pstmt)
-		return false;
+	elog(DEBUG1, "gtt_load_global_temporary_tables()");
 
-	/* no relation in rtable probably a function call */
-	if (list_length(pstmt->rtable) == 0)
-		return false;
+	elog(DEBUG1, "retrieve GTT list from definition table %s.%s", pgtt_namespace_name, CATALOG_GLOBAL_TEMP_REL);
+
+	/* Set and open the GTT definition storage relation */
+	rv = makeRangeVar(pgtt_namespace_name, CATALOG_GLOBAL_TEMP_REL, -1);
+
+	/* Open the CATALOG_GLOBAL_TEMP_REL table. We don't want to allow
+	 * writable accesses by other session during import. */
+	PushActiveSnapshot(GetTransactionSnapshot());
+	snapshot = GetActiveSnapshot();
 
-	/* This must be a valid relation and not a temporary table */
-	rte = (RangeTblEntry *) linitial(pstmt->rtable);
-	if (rte->relid != InvalidOid && rte->relkind == RELKIND_RELATION
-				&& !is_catalog_relid(rte->relid))
-	{
 #if (PG_VERSION_NUM >= 120000)
-		rel = table_open(rte->relid, NoLock);
+	rel = table_openrv(rv, AccessShareLock);
+	gtt_registry_relid = RelationGetRelid(rel);
+#if (PG_VERSION_NUM >= 190000)
+	scan = table_beginscan(rel, snapshot, 0, (ScanKey) NULL, SO_NONE);
 #else
-		rel = heap_open(rte->relid, NoLock);
+	scan = table_beginscan(rel, snapshot, 0, (ScanKey) NULL);
 #endif
-		name = RelationGetRelationName(rel);
-		relpersistence = rel->rd_rel->relpersistence;
-#if (PG_VERSION_NUM >= 120000)
-		table_close(rel, NoLock);
 #else
-		heap_close(rel, NoLock);
+	rel = heap_openrv(rv, AccessShareLock);
+	scan = heap_beginscan(rel, snapshot, 0, (ScanKey) NULL);
 #endif
+	tupleDesc = RelationGetDescr(rel);
+	numberOfAttributes = tupleDesc->natts;
+	while (HeapTupleIsValid(tuple = heap_getnext(scan, ForwardScanDirection)))
+	{
+		Oid namespaceId;
+		Gtt gtt;
+		Datum *values = (Datum *) palloc(numberOfAttributes * sizeof(Datum));
+		bool *isnull = (bool *) palloc(numberOfAttributes * sizeof(bool));
 
-		/* Do not go further with temporary tables, catalog or toast table */
-		if (relpersistence != RELPERSISTENCE_TEMP)
-			return false;
-
-		gtt.relid = 0;
-		gtt.temp_relid = 0;
-		gtt.relname[0] = '\0';
-		gtt.preserved = false;
+		/* Extract data */
+		heap_deform_tuple(tuple, tupleDesc, values, isnull);
+		strlcpy(gtt.relname, NameStr(*(DatumGetName(values[2]))), sizeof(gtt.relname));
+		gtt.preserved = DatumGetBool(values[3]);
+		/* the definition is only read from the registry when needed */
 		gtt.code = NULL;
 		gtt.created = false;
-
-		/* Check if the table is in the hash list and it has not already be created */
-		if ((const void*)name != NULL)
-			GttHashTableLookup(name, gtt);
-
-		elog(DEBUG1, "gtt_table_exists() looking for table \"%s\" with relid %d into cache.", name, rte->relid);
-		if (gtt.relname[0] != '\0')
+		gtt.seeded = false;
+		gtt.temp_relid = 0;
+		/* the seeded option is needed to route the queries */
+		if (numberOfAttributes > 5 && !isnull[5])
 		{
-			elog(DEBUG1, "GTT found in cache with name: %s, relid: %d, temp_relid %d", gtt.relname, gtt.relid, gtt.temp_relid);
-			/* Create the temporary table if it does not exists */
-			if (!gtt.created)
+			Datum  *elems;
+			bool   *nulls;
+			int     nelems;
+			int     i;
+
+			deconstruct_array(DatumGetArrayTypeP(values[5]), TEXTOID, -1, false, 'i',
+								&elems, &nulls, &nelems);
+			for (i = 0; i < nelems; i++)
 			{
-				ParseState *pstate = make_parsestate(NULL);
+				char *opt;
 
-				elog(DEBUG1, "global temporary table does not exists create it: %s", gtt.relname);
-				/* Call create temporary table */
-				if ((gtt.temp_relid = create_temporary_table_internal(pstate, gtt.relid, gtt.preserved)) != InvalidOid)
-				{
-					elog(DEBUG1, "global temporary table %s (oid: %d) created", gtt.relname, gtt.temp_relid);
-					/* Update hash list with table flagged as created */
-					gtt.created = true;
-					GttHashTableDelete(gtt.relname);
-					GttHashTableInsert(gtt, gtt.relname);
-					free_parsestate(pstate);
-				}
-				else
-					elog(ERROR, "can not create global temporary table %s", gtt.relname);
+				if (nulls[i])
+					continue;
+				opt = TextDatumGetCString(elems[i]);
+				if (strncmp(opt, "seeded=", 7) == 0)
+					(void) parse_bool(opt + 7, &gtt.seeded);
 			}
-			is_gtt = true;
 		}
-		else
-			/* the table is not a global temporary table do nothing*/
-			elog(DEBUG1, "table \"%s\" not registered as GTT", name);
+		/* get relation id */
+		namespaceId = LookupExplicitNamespace(pgtt_namespace_name, false);
+		gtt.relid = get_relname_relid(gtt.relname, namespaceId);
+		/* Add table to cache */
+		GttHashTableInsert(gtt, gtt.relname);
+		pfree(values);
+		pfree(isnull);
 	}
 
-	return is_gtt;
+	/* Cleanup. */
+#if (PG_VERSION_NUM >= 120000)
+	table_endscan(scan);
+	table_close(rel, AccessShareLock);
+#else
+	heap_endscan(scan);
+	heap_close(rel, AccessShareLock);
+#endif
+
+	PopActiveSnapshot();
 }
 
-static bool
-is_declared_gtt(Oid relid)
+/*
+ * Return the first tablespace of the tablespace option of a GTT that still
+ * exists and where the current user can create the temporary table, NULL
+ * to use the temp_tablespaces.
+ */
+static char *
+gtt_choose_tablespace(Oid relid, const char *rawname)
 {
-	char    *name = NULL;
-	char    relpersistence;
-	Relation      rel;
-	Gtt           gtt;
+	List       *namelist;
+	ListCell   *lc;
 
-	if (GttHashTable == NULL)
-		return false;
+	if (rawname == NULL)
+		return NULL;
 
-	/* This must be a valid relation and not a temporary table */
-	if (relid != InvalidOid && !is_catalog_relid(relid))
-	{
-#if (PG_VERSION_NUM >= 120000)
-		rel = table_open(relid, NoLock);
-#else
-		rel = heap_open(relid, NoLock);
-#endif
-		name = RelationGetRelationName(rel);
-		relpersistence = rel->rd_rel->relpersistence;
-#if (PG_VERSION_NUM >= 120000)
-		table_close(rel, NoLock);
-#else
-		heap_close(rel, NoLock);
-#endif
+	if (!SplitIdentifierString(pstrdup(rawname), ',', &namelist))
+		return NULL;
 
-		/* Do not go further with temporary tables, catalog or toast table */
-		if (relpersistence != RELPERSISTENCE_TEMP)
-			return false;
+	foreach(lc, namelist)
+	{
+		char           *spcname = (char *) lfirst(lc);
+		Oid             spcid = get_tablespace_oid(spcname, true);
+		AclResult       aclresult;
 
-		/* Check if the table is in the hash list and it has not already be created */
-		gtt.relid = 0;
-		gtt.temp_relid = 0;
-		gtt.relname[0] = '\0';
-		gtt.preserved = false;
-		gtt.code = NULL;
-		gtt.created = false;
+		if (!OidIsValid(spcid) || spcid == GLOBALTABLESPACE_OID)
+		{
+			elog(DEBUG1, "tablespace \"%s\" of GTT with Oid %d can not be used", spcname, relid);
+			continue;
+		}
+		if (spcid == MyDatabaseTableSpace)
+			return spcname;
 
-		if ((const void*)name != NULL)
-			GttHashTableLookup(name, gtt);
+#if PG_VERSION_NUM >= 160000
+		aclresult = object_aclcheck(TableSpaceRelationId, spcid, GetUserId(), ACL_CREATE);
+#else
+		aclresult = pg_tablespace_aclcheck(spcid, GetUserId(), ACL_CREATE);
+#endif
+		if (aclresult == ACLCHECK_OK)
+			return spcname;
 
-		if (gtt.relname[0] != '\0')
-			return true;
+		elog(DEBUG1, "permission denied for tablespace \"%s\" of GTT with Oid %d", spcname, relid);
 	}
 
-	return false;
+	return NULL;
 }
 
-
-int
-strpos(char *hay, char *needle, int offset)
+/*
+ * Build the statement creating the "template" table of a partitioned GTT
+ * or of a partition of a GTT. A partitioned table is never unlogged, the
+ * access method and the tablespace are recorded in the registry and the
+ * parent of a partition must be a GTT whose ON COMMIT clause is inherited.
+ */
+static CreateStmt *
+gtt_partition_template_stmt(CreateStmt *stmt, bool *preserved)
 {
-	char *haystack;
-	char *p;
+	CreateStmt *tmpl = (CreateStmt *) copyObject(stmt);
 
-	haystack = (char *) malloc(strlen(hay));
-	if (haystack == NULL)
+	tmpl->relation->schemaname = pstrdup(pgtt_namespace_name);
+	tmpl->relation->relpersistence = (stmt->partspec != NULL) ?
+						RELPERSISTENCE_PERMANENT : RELPERSISTENCE_UNLOGGED;
+	tmpl->oncommit = ONCOMMIT_NOOP;
+	tmpl->accessMethod = NULL;
+	tmpl->tablespacename = NULL;
+
+	if (stmt->partbound != NULL)
 	{
-		fprintf(stderr, "out of memory\n");
-		exit(EXIT_FAILURE);
-		return -1;
-	}
-	memset(haystack, 0, strlen(hay));
+		RangeVar   *parent = (RangeVar *) linitial(tmpl->inhRelations);
+		Gtt         gtt;
 
-	strncpy(haystack, hay+offset, strlen(hay)-offset);
-	p = strstr(haystack, needle);
-	if (p)
-		return p - haystack+offset;
+		gtt.relname[0] = '\0';
+		if (parent->schemaname == NULL
+				|| strcmp(parent->schemaname, pgtt_namespace_name) == 0)
+			GttHashTableLookup(parent->relname, gtt);
+		if (gtt.relname[0] == '\0')
+			ereport(ERROR,
+					(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+					 errmsg("the parent of a global temporary table partition must be a global temporary table")));
+		if ((stmt->oncommit == ONCOMMIT_DELETE_ROWS && gtt.preserved)
+				|| (stmt->oncommit == ONCOMMIT_PRESERVE_ROWS && !gtt.preserved))
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_TABLE_DEFINITION),
+					 errmsg("ON COMMIT clause of partition \"%s\" must match the one of global temporary table \"%s\"",
+							stmt->relation->relname, gtt.relname)));
 
-	return -1;
+		if (gtt.created)
+			elog(ERROR, "can not add a partition to a GTT that is in use.");
+
+		parent->schemaname = pstrdup(pgtt_namespace_name);
+		parent->relpersistence = RELPERSISTENCE_PERMANENT;
+		*preserved = gtt.preserved;
+	}
+	else if (stmt->oncommit == ONCOMMIT_DELETE_ROWS)
+		*preserved = false;
+
+	return tmpl;
 }
 
 /*
- * Create the Global Temporary Table with all associated objects
- * by creating the template table and register the GTT in the
- * pg_global_temp_tables table.
- *
+ * Create the temporary tables of the whole partition tree of a GTT whose
+ * "template" table is a partition and return the Oid of the temporary
+ * table of this partition.
  */
 static Oid
-gtt_create_table_statement(Gtt gtt)
+gtt_instantiate_partition_tree(ParseState *pstate, Oid relid)
 {
-	char    *newQueryString = NULL;
-	int     connected = 0;
-	int     finished = 0;
-	int     result = 0;
-	Oid     gttOid = InvalidOid;
-	Datum   oidDatum;
-	bool    isnull;
-
-	elog(DEBUG1, "proceeding to Global Temporary Table creation.");
-
-	connected = SPI_connect();
-	if (connected != SPI_OK_CONNECT)
-		ereport(ERROR, (errmsg("could not connect to SPI manager")));
+	Oid         root_relid = llast_oid(get_partition_ancestors(relid));
+	char       *name;
+	Gtt         gtt;
 
-	/* Create the "template" table */
-	newQueryString = psprintf("CREATE UNLOGGED TABLE %s.%s (%s)",
-			quote_identifier(pgtt_namespace_name),
-			quote_identifier(gtt.relname),
-			gtt.code);
-	result = SPI_exec(newQueryString, 0);
-	if (result < 0)
-		ereport(ERROR, (errmsg("execution failure on query: \"%s\"", newQueryString)));
+	name = get_rel_name(root_relid);
+	gtt.relname[0] = '\0';
+	if (name != NULL)
+		GttHashTableLookup(name, gtt);
+	if (gtt.relname[0] == '\0')
+		ereport(ERROR,
+				(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+				 errmsg("the root of the partition tree of global temporary table with Oid %u is not a global temporary table",
+						relid)));
 
-	/* Get Oid of the newly created table */
-	newQueryString = psprintf("SELECT c.relfilenode FROM pg_class c JOIN pg_namespace n ON (c.relnamespace=n.oid) WHERE c.relname=%s AND n.nspname = %s",
-			quote_literal_cstr(gtt.relname),
-			quote_literal_cstr(pgtt_namespace_name));
+	elog(DEBUG1, "instantiating partition tree of GTT \"%s\" for partition with Oid %d", gtt.relname, relid);
+	gtt_instantiate(pstate, &gtt, true);
 
-	result = SPI_exec(newQueryString, 0);
-	if (result != SPI_OK_SELECT && SPI_processed != 1)
-		ereport(ERROR, (errmsg("execution failure on query: \"%s\"", newQueryString)));
+	name = get_rel_name(relid);
+	gtt.relname[0] = '\0';
+	GttHashTableLookup(name, gtt);
+	if (gtt.relname[0] == '\0' || !gtt.created)
+		elog(ERROR, "can not create global temporary table %s", name);
 
-	oidDatum = SPI_getbinval(SPI_tuptable->vals[0], SPI_tuptable->tupdesc, 1, &isnull);
+	return gtt.temp_relid;
+}
 
-	if (!isnull)
-		gttOid = DatumGetInt32(oidDatum);
+/*
+ * Return the partition key of a partitioned "template" table as it is
+ * found in a CREATE TABLE statement.
+ */
+static PartitionSpec *
+gtt_template_partspec(Oid relid)
+{
+	char       *partkeydef;
+	List       *raw_parsetree_list;
+	CreateStmt *stmt;
 
-	if (isnull || !OidIsValid(gttOid))
-		ereport(ERROR,
-				(errmsg("can not get OID of newly created GTT template table %s",
-							quote_identifier(gtt.relname))));
+	partkeydef = TextDatumGetCString(DirectFunctionCall1(pg_get_partkeydef,
+									ObjectIdGetDatum(relid)));
+	partkeydef = psprintf("CREATE TABLE pgtt_partspec () PARTITION BY %s", partkeydef);
+#if (PG_VERSION_NUM >= 140000)
+	raw_parsetree_list = raw_parser(partkeydef, RAW_PARSE_DEFAULT);
+#else
+	raw_parsetree_list = raw_parser(partkeydef);
+#endif
+	stmt = (CreateStmt *) ((RawStmt *) linitial(raw_parsetree_list))->stmt;
 
-	/* Now register the GTT table */
-	newQueryString = psprintf("INSERT INTO %s.pg_global_temp_tables VALUES (%d, %s, %s, '%c', %s)",
-			quote_identifier(pgtt_namespace_name),
-			gttOid,
-			quote_literal_cstr(pgtt_namespace_name),
-			quote_literal_cstr(gtt.relname),
-			(gtt.preserved) ? 't' : 'f',
-			quote_literal_cstr(gtt.code)
-		);
-	result = SPI_exec(newQueryString, 0);
-	if (result < 0)
-		ereport(ERROR, (errmsg("can not registrer new global temporary table")));
+	return stmt->partspec;
+}
 
-	/*
-	 * Set privilege on the unlogged table. Only SELECT is granted to
-	 * PUBLIC here (previously ALL was granted, which let any role
-	 * INSERT/UPDATE/DELETE/TRUNCATE data in this table, and attach
-	 * triggers to it, regardless of ownership). SELECT is kept so the
-	 * documented "SET pgtt.enabled TO off; SELECT * FROM <schema>.<t>"
-	 * diagnostic pattern keeps working for any role.
-	 */
-	newQueryString = psprintf("GRANT SELECT ON TABLE %s.%s TO public",
-			quote_identifier(pgtt_namespace_name),
-			quote_identifier(gtt.relname));
-	result = SPI_exec(newQueryString, 0);
-	if (result < 0)
-		ereport(ERROR, (errmsg("execution failure on query: \"%s\"", newQueryString)));
+/*
+ * Create the temporary tables of the partitions of a partitioned "template"
+ * table and attach them to its temporary table with the same bounds. The
+ * partitions are created from their own "template" table so they keep
+ * their own indexes, constraints and storage parameters.
+ */
+static void
+gtt_attach_partitions(ParseState *pstate, Oid parent_relid, Oid temp_relid)
+{
+	List       *children = find_inheritance_children(parent_relid, NoLock);
+	char       *temp_relname = get_rel_name(temp_relid);
+	ListCell   *lc;
 
+	foreach(lc, children)
+	{
+		Oid         child_relid = lfirst_oid(lc);
+		char       *name = get_rel_name(child_relid);
+		HeapTuple   tuple;
+		Datum       datum;
+		bool        isnull;
+		char       *bound;
+		Gtt         gtt;
 
-	/* Mark the GTT as been created before register the table in the cache */
-	gtt.created = true;
+		gtt.relname[0] = '\0';
+		if (name != NULL)
+			GttHashTableLookup(name, gtt);
+		if (gtt.relname[0] == '\0')
+			ereport(ERROR,
+					(errcode(ERRCODE_WRONG_OBJECT_TYPE),
+					 errmsg("partition \"%s\" of global temporary table \"%s\" is not a global temporary table",
+							name, temp_relname)));
 
-	finished = SPI_finish();
-	if (finished != SPI_OK_FINISH)
-		ereport(ERROR, (errmsg("could not disconnect from SPI manager")));
+		if (!gtt.created)
+		{
+			gtt.temp_relid = create_temporary_table_internal(pstate, child_relid,
+													gtt.preserved, true, true);
+			if (!OidIsValid(gtt.temp_relid))
+				elog(ERROR, "can not create global temporary table %s", gtt.relname);
+			gtt.created = true;
+			GttHashTableDelete(gtt.relname);
+			GttHashTableInsert(gtt, gtt.relname);
+		}
 
-	return gttOid;
+		tuple = SearchSysCache1(RELOID, ObjectIdGetDatum(child_relid));
+		if (!HeapTupleIsValid(tuple))
+			elog(ERROR, "cache lookup failed for relation %u", child_relid);
+		datum = SysCacheGetAttr(RELOID, tuple, Anum_pg_class_relpartbound, &isnull);
+		if (isnull)
+			elog(ERROR, "relation %u has no partition bound", child_relid);
+		bound = TextDatumGetCString(DirectFunctionCall2(pg_get_expr, datum,
+										ObjectIdGetDatum(child_relid)));
+		ReleaseSysCache(tuple);
+
+		elog(DEBUG1, "attaching temporary table \"%s\" to \"%s\" %s", gtt.relname, temp_relname, bound);
+
+		if (SPI_connect() != SPI_OK_CONNECT)
+			elog(ERROR, "could not connect to SPI manager");
+		if (SPI_exec(psprintf("ALTER TABLE pg_temp.%s ATTACH PARTITION pg_temp.%s %s",
+						quote_identifier(temp_relname),
+						quote_identifier(gtt.relname), bound), 0) != SPI_OK_UTILITY)
+			ereport(ERROR,
+					(errmsg("can not attach temporary table \"%s\" to \"%s\"",
+							gtt.relname, temp_relname)));
+		SPI_finish();
+	}
 }
 
 /*
- * Unregister a Global Temporary Table in pg_global_temp_tables table
- * using his relid.
+ * Unregister the partitions of a partitioned GTT that is dropped, they are
+ * dropped with it. The partitions can not be in use when their parent is
+ * not.
  */
 static void
-gtt_unregister_global_temporary_table(const char *relname)
+gtt_unregister_partitions(Oid relid)
 {
-	RangeVar     *rv;
-	Relation      rel;
-	ScanKeyData   key[1];
-	SysScanDesc   scan;
-	HeapTuple     tuple;
+	List       *children = find_all_inheritors(relid, NoLock, NULL);
+	ListCell   *lc;
 
-	elog(DEBUG1, "Looking for registered GTT relname = %s", relname);
+	foreach(lc, children)
+	{
+		Oid         child_relid = lfirst_oid(lc);
+		char       *name;
+		Gtt         gtt;
 
-	/* Set and open the GTT relation */
-	rv = makeRangeVar(pgtt_namespace_name, CATALOG_GLOBAL_TEMP_REL, -1);
-#if (PG_VERSION_NUM >= 120000)
-	rel = table_openrv(rv, RowExclusiveLock);
-#else
-	rel = heap_openrv(rv, RowExclusiveLock);
-#endif
-	/* Define scanning */
-	ScanKeyInit(&key[0], Anum_pgtt_relname, BTEqualStrategyNumber, F_NAMEEQ, CStringGetDatum(relname));
+		if (child_relid == relid || (name = get_rel_name(child_relid)) == NULL)
+			continue;
 
-	/* Start search of relation */
-	scan = systable_beginscan(rel, 0, true, NULL, 1, key);
-	/* Remove the tuples. */
-	while (HeapTupleIsValid(tuple = systable_getnext(scan)))
-	{
-		elog(DEBUG1, "removing tuple with relname = %s", relname);
-		simple_heap_delete(rel, &tuple->t_self);
+		gtt.relname[0] = '\0';
+		GttHashTableLookup(name, gtt);
+		if (gtt.relname[0] == '\0')
+			continue;
+		if (gtt.created)
+			elog(ERROR, "can not drop a GTT that is in use.");
+
+		gtt_unregister_global_temporary_table(gtt.relname);
+		gtt_learned_statistics_row(gtt.relid, false);
+		GttHashTableDelete(gtt.relname);
 	}
-	/* Cleanup. */
-	systable_endscan(scan);
-#if (PG_VERSION_NUM >= 120000)
-	table_close(rel, RowExclusiveLock);
-#else
-	heap_close(rel, RowExclusiveLock);
-#endif
 }
 
 /*
- * Unregister a Global Temporary Table in pg_global_temp_tables table
- * that is not cached and using his name only.
+ * Make the serial and identity columns of a new temporary table take their
+ * values from pgtt_nextval(): a serial column uses the shared sequence of
+ * the "template" table otherwise, and an identity column its own temporary
+ * sequence. Nothing is done when the extension has not been updated.
  */
 static void
-gtt_unregister_gtt_not_cached(const char *relname)
+gtt_set_session_sequences(Oid parent_relid, const char *relname)
 {
-	RangeVar     *rv;
-	Relation      rel;
-	ScanKeyData   key[1];
-	SysScanDesc   scan;
-	HeapTuple     tuple;
+	char           *query;
+	SPITupleTable  *tuptable;
+	uint64          processed;
+	uint64          i;
+
+	query = psprintf("SELECT pg_catalog.format('ALTER TABLE pg_temp.%%I ALTER COLUMN %%I SET DEFAULT %%I.pgtt_nextval(%%L::regclass)',"
+			" %s, a.attname, %s, d.objid)"
+			" FROM pg_catalog.pg_depend d"
+			" JOIN pg_catalog.pg_class s ON (s.oid = d.objid AND s.relkind = 'S')"
+			" JOIN pg_catalog.pg_attribute a ON (a.attrelid = d.refobjid AND a.attnum = d.refobjsubid)"
+			" LEFT JOIN pg_catalog.pg_attrdef ad ON (ad.adrelid = a.attrelid AND ad.adnum = a.attnum)"
+			" WHERE d.classid = 'pg_catalog.pg_class'::pg_catalog.regclass"
+			" AND d.refclassid = 'pg_catalog.pg_class'::pg_catalog.regclass"
+			" AND d.refobjid = %u AND NOT a.attisdropped"
+			" AND pg_catalog.to_regprocedure(%s) IS NOT NULL"
+			" AND ((d.deptype = 'i' AND a.attidentity <> '')"
+			"  OR (d.deptype = 'a' AND pg_catalog.pg_get_expr(ad.adbin, ad.adrelid)"
+			"   = 'nextval(' || pg_catalog.quote_literal(d.objid::pg_catalog.regclass::text) || '::regclass)'))"
+			" ORDER BY a.attnum",
+			quote_literal_cstr(relname),
+			quote_literal_cstr(pgtt_namespace_name),
+			parent_relid,
+			quote_literal_cstr(psprintf("%s.pgtt_nextval(regclass)",
+							quote_identifier(pgtt_namespace_name))));
 
-	elog(DEBUG1, "Looking for registered GTT relname = %s", relname);
+	if (SPI_connect() != SPI_OK_CONNECT)
+		ereport(ERROR, (errmsg("could not connect to SPI manager")));
 
-	/* Set and open the GTT relation */
-	rv = makeRangeVar(pgtt_namespace_name, CATALOG_GLOBAL_TEMP_REL, -1);
-#if (PG_VERSION_NUM >= 120000)
-	rel = table_openrv(rv, RowExclusiveLock);
-#else
-	rel = heap_openrv(rv, RowExclusiveLock);
-#endif
-	/* Define scanning */
-	ScanKeyInit(&key[0], Anum_pgtt_relname, BTEqualStrategyNumber, F_NAMEEQ, CStringGetDatum(relname));
+	if (SPI_exec(query, 0) != SPI_OK_SELECT)
+		ereport(ERROR,
+				(errmsg("can not look for the sequences of global temporary table \"%s\"", relname)));
 
-	/* Start search of relation */
-	scan = systable_beginscan(rel, 0, true, NULL, 1, key);
-	/*
-	 * Remove the tuples, but only those the current user is actually
-	 * allowed to drop. Previously this deleted any matching row
-	 * unconditionally, before PostgreSQL's own ownership check on the
-	 * subsequent DROP TABLE ever ran -- letting any authenticated role
-	 * deregister another user's Global Temporary Table simply by
-	 * naming it in a DROP TABLE statement, even though that statement
-	 * would itself go on to fail with a permission error.
-	 */
-	while (HeapTupleIsValid(tuple = systable_getnext(scan)))
+	tuptable = SPI_tuptable;
+	processed = SPI_processed;
+	for (i = 0; i < processed; i++)
 	{
-		bool  isnull;
-		Datum relidDatum = heap_getattr(tuple, Anum_pgtt_relid, RelationGetDescr(rel), &isnull);
+		char *ddl = SPI_getvalue(tuptable->vals[i], tuptable->tupdesc, 1);
 
-		if (isnull || !gtt_current_user_can_drop(DatumGetInt32(relidDatum)))
-		{
-			systable_endscan(scan);
-#if (PG_VERSION_NUM >= 120000)
-			table_close(rel, RowExclusiveLock);
-#else
-			heap_close(rel, RowExclusiveLock);
-#endif
+		elog(DEBUG1, "session sequence on temporary table \"%s\": %s", relname, ddl);
+		if (SPI_exec(ddl, 0) != SPI_OK_UTILITY)
 			ereport(ERROR,
-					(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
-					 errmsg("must be owner of Global Temporary Table \"%s\" to drop it", relname)));
-		}
-
-		elog(DEBUG1, "removing tuple with relname = %s", relname);
-		simple_heap_delete(rel, &tuple->t_self);
+					(errmsg("can not set the default of temporary table \"%s\"", relname)));
 	}
 
-	/* Cleanup. */
-	systable_endscan(scan);
-#if (PG_VERSION_NUM >= 120000)
-	table_close(rel, RowExclusiveLock);
-#else
-	heap_close(rel, RowExclusiveLock);
-#endif
+	SPI_finish();
 }
 
 /*
- * Check if pgtt hasn't been loaded yet, and try to load it in that case.
+ * Create the TOAST table of a temporary table when its columns need one,
+ * with the "toast." storage parameters found in options.
  */
 static void
-gtt_try_load(void)
+gtt_create_toast_table(Oid temp_relid, List *options)
 {
+	Datum           toast_options;
+#if PG_VERSION_NUM < 180000
+	static char     *validnsps[] = HEAP_RELOPT_NAMESPACES;
+#else
+	const char     *validnsps[] = HEAP_RELOPT_NAMESPACES;
+#endif
+
 	/*
-	 * Don't try to load if the extension is disabled, if we can't do it now or
-	 * if it's already loaded.
+	 * parse and validate reloptions for the toast
+	 * table
 	 */
-	if (!pgtt_is_enabled || !IsTransactionState() || GttHashTable != NULL)
-		return;
+	toast_options = transformRelOptions((Datum) 0,
+							options,
+							"toast",
+							validnsps,
+							true,
+							false);
 
-	/* Initialize list of Global Temporary Table */
-	if (EnableGttManager())
-	{
-		/*
-		 * Load temporary table definition from pg_global_temp_tables table
-		 * into our Hash table and pre-create the temporary tables.
-		 */
-		gtt_load_global_temporary_tables();
+	(void) heap_reloptions(RELKIND_TOASTVALUE, toast_options, true);
 
-		/*
-		 * Be sure that extension schema is at end of the search path so that
-		 * "template" tables will be found.
-		 */
-		force_pgtt_namespace();
-	}
+	NewRelationCreateToastTable(temp_relid, toast_options);
 }
 
-#if PG_VERSION_NUM < 160000
 /*
- * From src/backend/commands/extension.c
+ * Create the TOAST table of a temporary table of GTT created by the lean
+ * profile before rows are written to it. A wide value could not be stored
+ * otherwise.
  */
-Oid
-get_extension_schema(Oid ext_oid)
+static void
+gtt_create_lazy_toast(Oid temp_relid)
 {
-	Oid                     result;
-	Relation        rel;
-	SysScanDesc scandesc;
+	GttSessionRel  *srel;
 	HeapTuple       tuple;
-	ScanKeyData entry[1];
-
-#if (PG_VERSION_NUM >= 120000)
-	rel = table_open(ExtensionRelationId, AccessShareLock);
-#else
-	rel = heap_open(ExtensionRelationId, AccessShareLock);
-#endif
+	Oid             toast_relid;
 
-	ScanKeyInit(&entry[0],
-#if (PG_VERSION_NUM >= 120000)
-				Anum_pg_extension_oid,
-#else
-				ObjectIdAttributeNumber,
-#endif
-				BTEqualStrategyNumber, F_OIDEQ,
-				ObjectIdGetDatum(ext_oid));
+	if (GttSessionRelTable == NULL || !OidIsValid(temp_relid))
+		return;
 
-	scandesc = systable_beginscan(rel, ExtensionOidIndexId, true,
-								  NULL, 1, entry);
+	srel = (GttSessionRel *) hash_search(GttSessionRelTable, &temp_relid, HASH_FIND, NULL);
+	if (srel == NULL || !srel->lazy_toast)
+		return;
 
-	tuple = systable_getnext(scandesc);
+	/* Checked each time, its creation may have been rolled back */
+	tuple = SearchSysCache1(RELOID, ObjectIdGetDatum(temp_relid));
+	if (!HeapTupleIsValid(tuple))
+		return;
+	toast_relid = ((Form_pg_class) GETSTRUCT(tuple))->reltoastrelid;
+	ReleaseSysCache(tuple);
+	if (OidIsValid(toast_relid))
+		return;
 
-	/* We assume that there can be at most one matching tuple */
-	if (HeapTupleIsValid(tuple))
-		result = ((Form_pg_extension) GETSTRUCT(tuple))->extnamespace;
-	else
-		result = InvalidOid;
+	elog(DEBUG1, "creating TOAST table of temporary table with Oid %u", temp_relid);
+	gtt_create_toast_table(temp_relid, gtt_template_reloptions(srel->relid));
+	CommandCounterIncrement();
+}
 
-	systable_endscan(scandesc);
+/*
+ * Empty the temporary table of a GTT bound to a local temporary table,
+ * nothing is done when it is known to be empty.
+ */
+static void
+gtt_truncate_bound_table(GttSessionRel *srel)
+{
+	char   *relname;
 
-#if (PG_VERSION_NUM >= 120000)
-	table_close(rel, AccessShareLock);
-#else
-	heap_close(rel, AccessShareLock);
-#endif
+	if (GTT_KNOWN_EMPTY(srel))
+		return;
 
-	return result;
+	relname = get_rel_name(srel->temp_relid);
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "could not connect to SPI manager");
+	if (SPI_exec(psprintf("TRUNCATE TABLE pg_temp.%s", quote_identifier(relname)), 0) != SPI_OK_UTILITY)
+		ereport(ERROR,
+				(errmsg("can not truncate temporary table \"%s\"", relname)));
+	SPI_finish();
 }
-#endif
-
 
 /*
- * EnableGttManager
- *              Enables the GTT management cache at backend startup.
+ * Use the temporary table of a GTT for a CREATE TEMPORARY TABLE without
+ * the GLOBAL keyword when the table has the name, the columns and the ON
+ * COMMIT behavior of the GTT. The temporary table is emptied as a new
+ * table would be. The constraints, defaults and options of the statement
+ * are not compared, the ones of the GTT apply. Returns false when the
+ * statement must create a local temporary table.
  */
-bool
-EnableGttManager(void)
+static bool
+gtt_bind_temp_table(CreateStmt *stmt)
 {
-	Oid extOid = get_extension_oid("pgtt", true);
-	RangeVar *rv;
-	char *nspname;
-
-	if (!OidIsValid(extOid))
+	Gtt             gtt;
+	Relation        rel;
+	TupleDesc       tupdesc;
+	GttSessionRel  *srel;
+	ListCell       *lc;
+	int             attnum = 0;
+	bool            match = true;
+
+	if (stmt->relation->schemaname != NULL
+			&& strcmp(stmt->relation->schemaname, "pg_temp") != 0)
 		return false;
 
-	pgtt_namespace_oid = get_extension_schema(extOid);
-	if (!OidIsValid(pgtt_namespace_oid))
-		elog(ERROR, "namespace %d can not be found.", pgtt_namespace_oid);
-
-	/*
-	 * Check if the GTT relation also exist. We might be in the middle of the
-	 * extension creation, where the line in pg_extension exists but not the
-	 * rest of SQL objects.
-	 */
-	nspname = get_namespace_name(pgtt_namespace_oid);
-	rv = makeRangeVar(nspname, CATALOG_GLOBAL_TEMP_REL, -1);
+	gtt.relname[0] = '\0';
+	GttHashTableLookup(stmt->relation->relname, gtt);
+	if (gtt.relname[0] == '\0' || stmt->inhRelations != NIL || stmt->ofTypename != NULL
+			|| stmt->partspec != NULL || stmt->partbound != NULL
+			|| get_rel_relispartition(gtt.relid)
+			|| get_rel_relkind(gtt.relid) != RELKIND_RELATION)
+		return false;
 
-	if (!OidIsValid(RangeVarGetRelid(rv, AccessShareLock, true)))
+	/* ON COMMIT DROP has no equivalent */
+	if (gtt.preserved ? (stmt->oncommit != ONCOMMIT_NOOP && stmt->oncommit != ONCOMMIT_PRESERVE_ROWS)
+					  : (stmt->oncommit != ONCOMMIT_DELETE_ROWS))
 		return false;
 
-	if (GttHashTable == NULL)
+	/* Same columns in the same order */
+	rel = table_open(gtt.relid, AccessShareLock);
+	tupdesc = RelationGetDescr(rel);
+	foreach(lc, stmt->tableElts)
 	{
-		HASHCTL         ctl;
+		ColumnDef      *coldef = (ColumnDef *) lfirst(lc);
+		Form_pg_attribute attr;
+		char           *typname;
+		Oid             typid = InvalidOid;
+		int32           typmod = -1;
 
-		MemSet(&ctl, 0, sizeof(ctl));
-		ctl.keysize = NAMEDATALEN;
-		ctl.entrysize = sizeof(GttHashEnt);
+		if (IsA(coldef, Constraint))
+			continue;
+		if (!IsA(coldef, ColumnDef))
+		{
+			match = false;
+			break;
+		}
 
-		/* allocate GTT Cache in the cache context */
-		ctl.hcxt = CacheMemoryContext;
-		GttHashTable = hash_create("Global Temporary Table hash list",
-									GTT_PER_DATABASE,
-									&ctl,
-#if PG_VERSION_NUM >= 140000
-									HASH_STRINGS | HASH_ELEM | HASH_CONTEXT
-#else
-									HASH_ELEM | HASH_CONTEXT
-#endif
-						);
-		elog(DEBUG1, "GTT cache initialized.");
+		while (attnum < tupdesc->natts && TupleDescAttr(tupdesc, attnum)->attisdropped)
+			attnum++;
+		if (attnum >= tupdesc->natts)
+		{
+			match = false;
+			break;
+		}
+		attr = TupleDescAttr(tupdesc, attnum++);
+
+		/* The serial types are not real types */
+		typname = strVal(llast(coldef->typeName->names));
+		if (list_length(coldef->typeName->names) == 1 && coldef->typeName->arrayBounds == NIL)
+		{
+			if (strcmp(typname, "smallserial") == 0 || strcmp(typname, "serial2") == 0)
+				typid = INT2OID;
+			else if (strcmp(typname, "serial") == 0 || strcmp(typname, "serial4") == 0)
+				typid = INT4OID;
+			else if (strcmp(typname, "bigserial") == 0 || strcmp(typname, "serial8") == 0)
+				typid = INT8OID;
+		}
+		if (!OidIsValid(typid))
+		{
+			Type tup = LookupTypeName(NULL, coldef->typeName, &typmod, true);
+
+			if (tup != NULL)
+			{
+				typid = typeTypeId(tup);
+				ReleaseSysCache(tup);
+			}
+		}
+
+		if (strcmp(NameStr(attr->attname), coldef->colname) != 0
+				|| attr->atttypid != typid || attr->atttypmod != typmod)
+		{
+			match = false;
+			break;
+		}
 	}
+	while (match && attnum < tupdesc->natts && TupleDescAttr(tupdesc, attnum)->attisdropped)
+		attnum++;
+	if (attnum < tupdesc->natts)
+		match = false;
+	table_close(rel, AccessShareLock);
 
-	/*
-	 * Set the OID and name of the extension schema, all objects will be
-	 * created in this schema.
-	 */
-	strlcpy(pgtt_namespace_name, nspname, sizeof(pgtt_namespace_name));
+	if (!match)
+	{
+		elog(DEBUG1, "temporary table \"%s\" does not match its GTT, it is created", gtt.relname);
+		return false;
+	}
+
+	gtt_instantiate(NULL, &gtt, true);
+	srel = (GttSessionRel *) hash_search(GttSessionRelTable, &gtt.temp_relid, HASH_FIND, NULL);
+	if (srel == NULL)
+		return false;
+
+	if (srel->bound)
+	{
+		if (!stmt->if_not_exists)
+			ereport(ERROR,
+					(errcode(ERRCODE_DUPLICATE_TABLE),
+					 errmsg("relation \"%s\" already exists", gtt.relname)));
+		ereport(NOTICE,
+				(errcode(ERRCODE_DUPLICATE_TABLE),
+				 errmsg("relation \"%s\" already exists, skipping", gtt.relname)));
+		return true;
+	}
+
+	/* A new table is empty */
+	gtt_truncate_bound_table(srel);
+	gtt_set_bound(srel, true);
+
+	elog(DEBUG1, "temporary table \"%s\" bound to its GTT", gtt.relname);
 
 	return true;
 }
 
 /*
- * Delete all declared Global Temporary Table.
- *
+ * DROP TABLE of a temporary table bound to a GTT: it is truncated and
+ * can be bound again. Returns false when the table is not bound.
  */
-void
-GttHashTableDeleteAll(void)
+static bool
+gtt_unbind_temp_table(Oid temp_relid)
 {
-	HASH_SEQ_STATUS status;
-	GttHashEnt *lentry = NULL;
+	GttSessionRel  *srel;
 
-	if (GttHashTable == NULL)
-		return;
+	if (GttSessionRelTable == NULL)
+		return false;
 
-	hash_seq_init(&status, GttHashTable);
-	while ((lentry = (GttHashEnt *) hash_seq_search(&status)) != NULL)
-	{
-		Gtt          gtt = GetGttByName(lentry->name);
+	srel = (GttSessionRel *) hash_search(GttSessionRelTable, &temp_relid, HASH_FIND, NULL);
+	if (srel == NULL || !srel->bound)
+		return false;
 
-		elog(DEBUG1, "Remove GTT %s from our hash table", gtt.relname);
-		GttHashTableDelete(lentry->name);
-		/* Restart the iteration in case that led to other drops */
-		hash_seq_term(&status);
-		hash_seq_init(&status, GttHashTable);
-	}
+	gtt_truncate_bound_table(srel);
+	gtt_set_bound(srel, false);
+
+	return true;
 }
 
 /*
- * GetGttByName
- *       Returns a Gtt given a table name, or NULL if name is not found.
- *
- * Caller should have made sure that GTT has been properly loaded before
- * calling this function.
+ * Change the bound state of a temporary table of GTT and remember the
+ * previous one for a rollback of the current subtransaction.
  */
-Gtt
-GetGttByName(const char *name)
+static void
+gtt_set_bound(GttSessionRel *srel, bool bound)
 {
-	Gtt          gtt;
+	MemoryContext   oldcontext = MemoryContextSwitchTo(TopTransactionContext);
+	GttBoundChange *change = (GttBoundChange *) palloc(sizeof(GttBoundChange));
 
-	Assert(GttHashTable != NULL);
-
-	if ((const void*)name != NULL)
-		GttHashTableLookup(name, gtt);
+	change->temp_relid = srel->temp_relid;
+	change->subid = GetCurrentSubTransactionId();
+	change->prev = srel->bound;
+	gtt_bound_changes = lcons(change, gtt_bound_changes);
+	MemoryContextSwitchTo(oldcontext);
 
-	return gtt;
+	srel->bound = bound;
 }
 
 /*
- * Execute a utility statement generated by pgtt as a sub-command of the
- * statement being processed.
+ * Record the use of a temporary table of GTT for the LRU eviction.
  */
 static void
-gtt_exec_utility_subcommand(Node *stmt, const char *querystring)
+gtt_touch_session_rel(Oid temp_relid)
 {
-#if PG_VERSION_NUM >= 100000
-	PlannedStmt *pstmt = makeNode(PlannedStmt);
+	GttSessionRel  *srel;
 
-	pstmt->commandType       = CMD_UTILITY;
-	pstmt->canSetTag         = true;
-	pstmt->utilityStmt       = stmt;
-	pstmt->stmt_location     = -1;
-	pstmt->stmt_len          = 0;
-	ProcessUtility(pstmt,
-					querystring,
-#if PG_VERSION_NUM >= 140000
-					false,
-#endif
-					PROCESS_UTILITY_SUBCOMMAND,
-					NULL, NULL,
-					None_Receiver,
-					NULL);
-#else
-	ProcessUtility(stmt,
-					querystring,
-					PROCESS_UTILITY_SUBCOMMAND,
-					NULL,
-					None_Receiver,
-					NULL);
-#endif
-}
+	if (pgtt_max_instantiated <= 0 || GttSessionRelTable == NULL || !OidIsValid(temp_relid))
+		return;
 
-/*
- * Definition of a trigger to be copied on the temporary table.
- */
-typedef struct GttTriggerDef
-{
-	char   *def;			/* CREATE TRIGGER statement */
-	char   *tgname;			/* name of the trigger */
-	char    tgenabled;		/* tgenabled state on the "template" table */
-} GttTriggerDef;
+	srel = (GttSessionRel *) hash_search(GttSessionRelTable, &temp_relid, HASH_FIND, NULL);
+	if (srel == NULL)
+		return;
+	srel->last_used = ++gtt_use_clock;
+	srel->xact_used = true;
+}
 
 /*
- * Restore on the temporary table the enabled state of a trigger when it
- * is not the default one. pg_get_triggerdef() does not report the
- * tgenabled state so the trigger is always created as ENABLE (fires on
- * origin) and an ALTER TABLE sub-command is required to fix it.
+ * Drop the least recently used temporary tables of GTT until the session
+ * has less than pgtt.max_instantiated of them. Only the empty tables that
+ * are not used by the current transaction, not bound to a local temporary
+ * table and not referenced are dropped, the limit can be exceeded when
+ * there is none. The GTT is instantiated again at its next use. The drop
+ * is done in a subtransaction, a table that can not be dropped, because
+ * a view depends on it for example, is skipped. The session state of the
+ * table is removed at commit, it is restored if the transaction aborts.
  */
 static void
-gtt_set_trigger_enabled(const char *relname, const char *tgname, char tgenabled)
+gtt_evict_session_rels(void)
 {
-	AlterTableStmt *atstmt;
-	AlterTableCmd  *atcmd;
-	const char     *action = NULL;
+	HASH_SEQ_STATUS status;
+	GttSessionRel  *srel;
+	long            count = 0;
+	long            attempts;
 
-	atcmd = makeNode(AlterTableCmd);
+	if (GttSessionRelTable == NULL)
+		return;
 
-	switch (tgenabled)
+	hash_seq_init(&status, GttSessionRelTable);
+	while ((srel = (GttSessionRel *) hash_seq_search(&status)) != NULL)
 	{
-		case TRIGGER_DISABLED:
-			atcmd->subtype = AT_DisableTrig;
-			action = "DISABLE TRIGGER";
-			break;
-		case TRIGGER_FIRES_ON_REPLICA:
-			atcmd->subtype = AT_EnableReplicaTrig;
-			action = "ENABLE REPLICA TRIGGER";
-			break;
-		case TRIGGER_FIRES_ALWAYS:
-			atcmd->subtype = AT_EnableAlwaysTrig;
-			action = "ENABLE ALWAYS TRIGGER";
-			break;
-		default:
-			/* TRIGGER_FIRES_ON_ORIGIN is the state set at creation time */
-			return;
+		if (!srel->evicted)
+			count++;
 	}
+	attempts = count;
 
-	atcmd->name = pstrdup(tgname);
-	atcmd->behavior = DROP_RESTRICT;
-	atcmd->missing_ok = false;
+	while (count >= pgtt_max_instantiated && attempts-- > 0)
+	{
+		GttSessionRel  *victim = NULL;
+		GttHashEnt     *hentry;
+		Oid             temp_relid;
+		Oid             relid;
+		Relation        rel;
+		bool            in_use;
+		bool            dropped = false;
+		MemoryContext   oldcontext = CurrentMemoryContext;
+		ResourceOwner   oldowner = CurrentResourceOwner;
+
+		hash_seq_init(&status, GttSessionRelTable);
+		while ((srel = (GttSessionRel *) hash_seq_search(&status)) != NULL)
+		{
+			/* an empty seeded GTT would be read again from its "template" */
+			if (srel->evicted || srel->xact_used || srel->bound || srel->seeded
+					|| !GTT_KNOWN_EMPTY(srel))
+				continue;
+			if (victim == NULL || srel->last_used < victim->last_used)
+				victim = srel;
+		}
+		if (victim == NULL)
+		{
+			elog(DEBUG1, "no temporary table of GTT can be evicted, %ld are instantiated", count);
+			break;
+		}
 
-	atstmt = makeNode(AlterTableStmt);
-	atstmt->relation = makeRangeVar("pg_temp", pstrdup(relname), -1);
-	atstmt->relation->relpersistence = RELPERSISTENCE_TEMP;
-	atstmt->cmds = list_make1(atcmd);
-	atstmt->missing_ok = false;
-	STMT_OBJTYPE(atstmt) = OBJECT_TABLE;
+		temp_relid = victim->temp_relid;
+		relid = victim->relid;
 
-	elog(DEBUG1, "restoring state of trigger \"%s\" on temporary table \"%s\": %s",
-			tgname, relname, action);
+		rel = RelationIdGetRelation(temp_relid);
+		if (!RelationIsValid(rel))
+		{
+			gtt_forget_session_rel(temp_relid);
+			count--;
+			continue;
+		}
+		/*
+		 * Still open by a cursor or a portal, or locked by the statement
+		 * being analyzed that already refers to the temporary table.
+		 */
+		in_use = (rel->rd_refcnt > 1);
+		if (CheckRelationLockedByMe(rel, AccessShareLock, true))
+			in_use = true;
+		RelationClose(rel);
+		if (in_use)
+		{
+			victim->last_used = ++gtt_use_clock;
+			continue;
+		}
 
-	gtt_exec_utility_subcommand((Node *) atstmt, "PGTT provide a query string");
-	CommandCounterIncrement();
+		BeginInternalSubTransaction(NULL);
+		MemoryContextSwitchTo(oldcontext);
+
+		PG_TRY();
+		{
+			ObjectAddress   object;
+
+			ObjectAddressSet(object, RelationRelationId, temp_relid);
+			performDeletion(&object, DROP_RESTRICT,
+							PERFORM_DELETION_INTERNAL | PERFORM_DELETION_QUIETLY);
+			CommandCounterIncrement();
+			dropped = true;
+
+			ReleaseCurrentSubTransaction();
+			MemoryContextSwitchTo(oldcontext);
+			CurrentResourceOwner = oldowner;
+		}
+		PG_CATCH();
+		{
+			ErrorData  *edata;
+
+			MemoryContextSwitchTo(oldcontext);
+			edata = CopyErrorData();
+			FlushErrorState();
+
+			RollbackAndReleaseCurrentSubTransaction();
+			MemoryContextSwitchTo(oldcontext);
+			CurrentResourceOwner = oldowner;
+
+			elog(DEBUG1, "can not evict temporary table with Oid %u: %s", temp_relid, edata->message);
+			FreeErrorData(edata);
+		}
+		PG_END_TRY();
+
+		/* The subtransaction may have moved the hash entry */
+		srel = (GttSessionRel *) hash_search(GttSessionRelTable, &temp_relid, HASH_FIND, NULL);
+		if (srel == NULL)
+			continue;
+		if (!dropped)
+		{
+			srel->last_used = ++gtt_use_clock;
+			continue;
+		}
+
+		elog(DEBUG1, "evicted temporary table with Oid %u of GTT with relid %u", temp_relid, relid);
+		srel->evicted = true;
+		srel->evicted_subid = GetCurrentSubTransactionId();
+		count--;
+
+		hash_seq_init(&status, GttHashTable);
+		while ((hentry = (GttHashEnt *) hash_seq_search(&status)) != NULL)
+		{
+			if (hentry->relid != relid)
+				continue;
+			hentry->created = false;
+			hentry->temp_relid = 0;
+			hash_seq_term(&status);
+			break;
+		}
+	}
 }
 
 /*
- * Copy on the temporary table the triggers defined on the "template"
- * table of a global temporary table.
- *
- * CREATE TABLE ... (LIKE ...) has no INCLUDING TRIGGERS option in
- * PostgreSQL, so the triggers must be replicated by hand once the
- * temporary table has been created. The definition of each trigger is
- * obtained through pg_get_triggerdef(), parsed back, and the relation
- * of the resulting CreateTrigStmt is changed to point to the temporary
- * table before being executed.
- *
- * See https://github.com/darold/pgtt/issues/52
+ * Flag a temporary table of GTT that has grown beyond its local buffers
+ * budget, the memory of the local buffers will be released when it is
+ * emptied. The size of the table is the upper bound of the number of
+ * local buffers it can use.
  */
 static void
-gtt_copy_triggers(Oid parent_relid, const char *relname)
+gtt_check_buffer_budget(GttSessionRel *srel)
 {
-	Relation      tgrel;
-	SysScanDesc   tgscan;
-	ScanKeyData   key;
-	HeapTuple     tuple;
-	List         *trigger_defs = NIL;
-	ListCell     *lc;
+	int         budget = (srel->buffer_budget >= 0) ? srel->buffer_budget : pgtt_buffer_budget;
+	Relation    rel;
 
-	elog(DEBUG1, "looking for triggers to copy from relation with Oid %d", parent_relid);
+	if (budget < 0)
+		return;
 
-	/*
-	 * Collect the definition of all the triggers of the "template" table
-	 * first, the catalog scan must be closed before executing any DDL.
-	 */
-	tgrel = table_open(TriggerRelationId, AccessShareLock);
+	rel = RelationIdGetRelation(srel->temp_relid);
+	if (!RelationIsValid(rel))
+		return;
+	if (RelationGetNumberOfBlocks(rel) > (BlockNumber) budget)
+	{
+		srel->over_budget = true;
+		elog(DEBUG1, "temporary table with Oid %d is beyond its budget of %d local buffers",
+					srel->temp_relid, budget);
+	}
+	RelationClose(rel);
+}
 
-	ScanKeyInit(&key,
-				Anum_pg_trigger_tgrelid,
-				BTEqualStrategyNumber, F_OIDEQ,
-				ObjectIdGetDatum(parent_relid));
+/*
+ * PostgreSQL never frees the local buffers of a session, after a large
+ * load the memory of the whole temp_buffers pool stays allocated. Give
+ * the memory pages of the local buffers that do not hold a block anymore,
+ * because their table has been emptied or dropped, back to the system.
+ * The pages are mapped again, zeroed, when the buffer is reused. Returns
+ * the number of local buffers released.
+ */
+static int64
+gtt_release_local_buffers(void)
+{
+	int64       released = 0;
+#if !defined(WIN32) && defined(MADV_DONTNEED)
+	static long pagesize = 0;
+	int         i;
 
-	tgscan = systable_beginscan(tgrel, TriggerRelidNameIndexId, true,
-								NULL, 1, &key);
+	gtt_release_pending = false;
 
-	while (HeapTupleIsValid(tuple = systable_getnext(tgscan)))
+	if (pagesize <= 0)
+		pagesize = sysconf(_SC_PAGESIZE);
+	if (pagesize <= 0 || pagesize > BLCKSZ)
+		return 0;
+
+	for (i = 0; i < NLocBuffer; i++)
 	{
-		Form_pg_trigger  trigform = (Form_pg_trigger) GETSTRUCT(tuple);
-		GttTriggerDef   *trigdef;
-		Oid              trigoid;
-		Datum            def;
+		BufferDesc *bufHdr = GetLocalBufferDescriptor(i);
+		char       *start;
+		char       *end;
 
-		/*
-		 * Skip triggers created internally by PostgreSQL, they are built
-		 * again with the constraints and indexes copied by the LIKE clause.
-		 */
-		if (trigform->tgisinternal)
+		if (LocalBufferBlockPointers[i] == NULL || LocalRefCount[i] != 0
+				|| (pg_atomic_read_u32(&bufHdr->state) & BM_TAG_VALID))
 			continue;
 
-#if (PG_VERSION_NUM >= 120000)
-		trigoid = trigform->oid;
-#else
-		trigoid = HeapTupleGetOid(tuple);
-#endif
+		/* Only the memory pages fully inside the block */
+		start = (char *) TYPEALIGN(pagesize, LocalBufferBlockPointers[i]);
+		end = (char *) TYPEALIGN_DOWN(pagesize, (char *) LocalBufferBlockPointers[i] + BLCKSZ);
+		if (end <= start)
+			continue;
 
-#if (PG_VERSION_NUM < 140000)
-		def = OidFunctionCall1(F_PG_GET_TRIGGERDEF, ObjectIdGetDatum(trigoid));
+		if (madvise(start, end - start, MADV_DONTNEED) == 0)
+			released++;
+	}
+
+	elog(DEBUG1, "memory of " INT64_FORMAT " unused local buffers released", released);
 #else
-		def = OidFunctionCall1(F_PG_GET_TRIGGERDEF_OID, ObjectIdGetDatum(trigoid));
+	gtt_release_pending = false;
 #endif
 
-		trigdef = (GttTriggerDef *) palloc0(sizeof(GttTriggerDef));
-		trigdef->def = TextDatumGetCString(def);
-		trigdef->tgname = pstrdup(NameStr(trigform->tgname));
-		trigdef->tgenabled = trigform->tgenabled;
-
-		trigger_defs = lappend(trigger_defs, trigdef);
-	}
-
-	systable_endscan(tgscan);
-	table_close(tgrel, AccessShareLock);
+	return released;
+}
 
-	if (trigger_defs == NIL)
+/*
+ * Read again from the registry the seeded option of all the GTT of the
+ * cache after it has been changed, by this session or by another one.
+ * The cached plans are invalidated when a GTT has changed, its queries
+ * must read its "template" table or its temporary table.
+ */
+static void
+gtt_refresh_seeded(void)
+{
+	HASH_SEQ_STATUS  status;
+	GttHashEnt      *hentry;
+	List            *relids = NIL;
+	char            *query;
+	bool             pushed_snapshot = false;
+	bool             changed = false;
+	MemoryContext    callercontext = CurrentMemoryContext;
+	uint64           i;
+
+	gtt_seeded_pending = false;
+
+	if (GttHashTable == NULL || !OidIsValid(gtt_registry_options_relid()))
 		return;
 
-	/* The temporary table must be visible before adding the triggers */
-	CommandCounterIncrement();
-
-	foreach (lc, trigger_defs)
+	if (!ActiveSnapshotSet())
 	{
-		GttTriggerDef *trigdef = (GttTriggerDef *) lfirst(lc);
-		List          *raw_parsetree_list;
-		ListCell      *lc2;
+		PushActiveSnapshot(GetTransactionSnapshot());
+		pushed_snapshot = true;
+	}
 
-		elog(DEBUG1, "copying trigger on temporary table: %s", trigdef->def);
+	query = psprintf("SELECT r.relid FROM %s.%s r, pg_catalog.unnest(r.options) o"
+					" WHERE pg_catalog.split_part(o, '=', 1) OPERATOR(pg_catalog.=) 'seeded'"
+					" AND pg_catalog.substr(o, pg_catalog.strpos(o, '=') + 1)::pg_catalog.bool",
+						quote_identifier(pgtt_namespace_name), CATALOG_GLOBAL_TEMP_REL);
 
-#if (PG_VERSION_NUM >= 140000)
-		raw_parsetree_list = raw_parser(trigdef->def, RAW_PARSE_DEFAULT);
-#else
-		raw_parsetree_list = raw_parser(trigdef->def);
-#endif
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "could not connect to SPI manager");
 
-		foreach (lc2, raw_parsetree_list)
-		{
-			CreateTrigStmt *trigstmt;
-#if (PG_VERSION_NUM >= 100000)
-			Node *parsetree = ((RawStmt *) lfirst(lc2))->stmt;
-#else
-			Node *parsetree = (Node *) lfirst(lc2);
-#endif
+	if (SPI_execute(query, true, 0) == SPI_OK_SELECT)
+	{
+		for (i = 0; i < SPI_processed; i++)
+		{
+			bool            isnull;
+			Datum           relid = SPI_getbinval(SPI_tuptable->vals[i], SPI_tuptable->tupdesc, 1, &isnull);
+			MemoryContext   oldcontext;
 
-			if (!IsA(parsetree, CreateTrigStmt))
+			if (isnull)
 				continue;
+			/* the list must survive SPI_finish() */
+			oldcontext = MemoryContextSwitchTo(callercontext);
+			relids = lappend_oid(relids, DatumGetObjectId(relid));
+			MemoryContextSwitchTo(oldcontext);
+		}
+	}
 
-			trigstmt = (CreateTrigStmt *) parsetree;
+	SPI_finish();
 
-			/* Redirect the trigger creation to the temporary table */
-			trigstmt->relation = makeRangeVar("pg_temp", pstrdup(relname), -1);
-			trigstmt->relation->relpersistence = RELPERSISTENCE_TEMP;
+	if (pushed_snapshot)
+		PopActiveSnapshot();
 
-			gtt_exec_utility_subcommand(parsetree, trigdef->def);
-			CommandCounterIncrement();
-		}
+	hash_seq_init(&status, GttHashTable);
+	while ((hentry = (GttHashEnt *) hash_seq_search(&status)) != NULL)
+	{
+		bool seeded = list_member_oid(relids, hentry->relid);
 
-		/*
-		 * The trigger is always created enabled, restore the state it has
-		 * on the "template" table when it is a different one.
-		 */
-		gtt_set_trigger_enabled(relname, trigdef->tgname, trigdef->tgenabled);
+		if (hentry->seeded == seeded)
+			continue;
+		elog(DEBUG1, "seeded option of GTT with relid %u is now %d", hentry->relid, seeded);
+		hentry->seeded = seeded;
+		changed = true;
 	}
+	list_free(relids);
+
+	if (changed)
+		ResetPlanCache();
 }
 
 /*
- * Load Global Temporary Table in memory from pg_global_temp_tables table.
+ * Copy the rows of the "template" table of a seeded GTT into the new
+ * temporary table of the session, the generated columns are computed
+ * again. Returns the number of rows copied.
  */
-static void
-gtt_load_global_temporary_tables(void)
+static uint64
+gtt_copy_seed_rows(Oid parent_relid, Oid temp_relid)
 {
-	RangeVar       *rv;
-	Relation       rel;
-#if (PG_VERSION_NUM >= 120000)
-	TableScanDesc  scan;
-#else
-	HeapScanDesc   scan;
-#endif
-	HeapTuple     tuple;
-	int           numberOfAttributes;
-	TupleDesc     tupleDesc;
-	Snapshot      snapshot;
+	Relation        rel;
+	TupleDesc       tupdesc;
+	StringInfoData  cols;
+	char           *query;
+	uint64          rows;
+	int             i;
+
+	initStringInfo(&cols);
+	rel = table_open(parent_relid, NoLock);
+	tupdesc = RelationGetDescr(rel);
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute attr = TupleDescAttr(tupdesc, i);
 
-	elog(DEBUG1, "gtt_load_global_temporary_tables()");
+		if (attr->attisdropped || attr->attgenerated != '\0')
+			continue;
+		if (cols.len > 0)
+			appendStringInfoString(&cols, ", ");
+		appendStringInfoString(&cols, quote_identifier(NameStr(attr->attname)));
+	}
+	table_close(rel, NoLock);
 
-	elog(DEBUG1, "retrieve GTT list from definition table %s.%s", pgtt_namespace_name, CATALOG_GLOBAL_TEMP_REL);
+	if (cols.len == 0)
+		return 0;
 
-	/* Set and open the GTT definition storage relation */
-	rv = makeRangeVar(pgtt_namespace_name, CATALOG_GLOBAL_TEMP_REL, -1);
+	query = psprintf("INSERT INTO pg_temp.%s (%s) OVERRIDING SYSTEM VALUE SELECT %s FROM %s.%s",
+					quote_identifier(get_rel_name(temp_relid)),
+					cols.data, cols.data,
+					quote_identifier(pgtt_namespace_name),
+					quote_identifier(get_rel_name(parent_relid)));
 
-	/* Open the CATALOG_GLOBAL_TEMP_REL table. We don't want to allow
-	 * writable accesses by other session during import. */
-	PushActiveSnapshot(GetTransactionSnapshot());
-	snapshot = GetActiveSnapshot();
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "could not connect to SPI manager");
 
-#if (PG_VERSION_NUM >= 120000)
-	rel = table_openrv(rv, AccessShareLock);
-#if (PG_VERSION_NUM >= 190000)
-	scan = table_beginscan(rel, snapshot, 0, (ScanKey) NULL, SO_NONE);
-#else
-	scan = table_beginscan(rel, snapshot, 0, (ScanKey) NULL);
-#endif
-#else
-	rel = heap_openrv(rv, AccessShareLock);
-	scan = heap_beginscan(rel, snapshot, 0, (ScanKey) NULL);
-#endif
-	tupleDesc = RelationGetDescr(rel);
-	numberOfAttributes = tupleDesc->natts;
-	while (HeapTupleIsValid(tuple = heap_getnext(scan, ForwardScanDirection)))
+	gtt_copying_seed_rows = true;
+	PG_TRY();
 	{
-		Oid namespaceId;
-		Gtt gtt;
-		Datum *values = (Datum *) palloc(numberOfAttributes * sizeof(Datum));
-		bool *isnull = (bool *) palloc(numberOfAttributes * sizeof(bool));
-
-		/* Extract data */
-		heap_deform_tuple(tuple, tupleDesc, values, isnull);
-		strlcpy(gtt.relname, NameStr(*(DatumGetName(values[2]))), sizeof(gtt.relname));
-		gtt.preserved = DatumGetBool(values[3]);
-		gtt.code = TextDatumGetCString(values[4]);
-		gtt.created = false;
-		gtt.temp_relid = 0;
-		/* get relation id */
-		namespaceId = LookupExplicitNamespace(pgtt_namespace_name, false);
-		gtt.relid = get_relname_relid(gtt.relname, namespaceId);
-		/* Add table to cache */
-		GttHashTableInsert(gtt, gtt.relname);
+		if (SPI_execute(query, false, 0) != SPI_OK_INSERT)
+			ereport(ERROR, (errmsg("execution failure on query: \"%s\"", query)));
+	}
+	PG_CATCH();
+	{
+		gtt_copying_seed_rows = false;
+		PG_RE_THROW();
 	}
+	PG_END_TRY();
+	gtt_copying_seed_rows = false;
+	rows = SPI_processed;
 
-	/* Cleanup. */
-#if (PG_VERSION_NUM >= 120000)
-	table_endscan(scan);
-	table_close(rel, AccessShareLock);
-#else
-	heap_endscan(scan);
-	heap_close(rel, AccessShareLock);
-#endif
+	SPI_finish();
+	CommandCounterIncrement();
 
-	PopActiveSnapshot();
+	elog(DEBUG1, "seeded temporary table with Oid %d with " UINT64_FORMAT " rows", temp_relid, rows);
+
+	return rows;
+}
+
+/*
+ * Return the storage parameters of a "template" table, including the ones
+ * of its TOAST table, as the options of a CREATE TABLE statement.
+ */
+static List *
+gtt_template_reloptions(Oid relid)
+{
+	List       *options = NIL;
+	List       *toast_options = NIL;
+	HeapTuple   tuple;
+	Datum       datum;
+	bool        isnull;
+	Oid         toast_relid;
+	ListCell   *lc;
+
+	tuple = SearchSysCache1(RELOID, ObjectIdGetDatum(relid));
+	if (!HeapTupleIsValid(tuple))
+		return NIL;
+	toast_relid = ((Form_pg_class) GETSTRUCT(tuple))->reltoastrelid;
+	datum = SysCacheGetAttr(RELOID, tuple, Anum_pg_class_reloptions, &isnull);
+	if (!isnull)
+		options = untransformRelOptions(datum);
+	ReleaseSysCache(tuple);
+
+	if (!OidIsValid(toast_relid))
+		return options;
+
+	tuple = SearchSysCache1(RELOID, ObjectIdGetDatum(toast_relid));
+	if (!HeapTupleIsValid(tuple))
+		return options;
+	datum = SysCacheGetAttr(RELOID, tuple, Anum_pg_class_reloptions, &isnull);
+	if (!isnull)
+		toast_options = untransformRelOptions(datum);
+	ReleaseSysCache(tuple);
+
+	foreach (lc, toast_options)
+		((DefElem *) lfirst(lc))->defnamespace = pstrdup("toast");
+
+	return list_concat(options, toast_options);
 }
 
 static Oid
-create_temporary_table_internal(ParseState *pstate, Oid parent_relid, bool preserved)
+create_temporary_table_internal(ParseState *pstate, Oid parent_relid, bool preserved,
+					bool in_partition_tree, bool copy_seed)
 {
 	/* Value to be returned */
 	Oid                         temp_relid = InvalidOid; /* safety */
@@ -2051,19 +7236,35 @@ create_temporary_table_internal(ParseState *pstate, Oid parent_relid, bool prese
 	char                       *parent_name,
 							   *parent_nsp_name;
 	char                        parent_persistence;
+	char                        parent_relkind;
 
 	/* Elements of the "CREATE TABLE" query tree */
 	RangeVar                   *parent_rv;
 	RangeVar                   *table_rv;
+	bool                        parent_locked;
 	TableLikeClause            *like_clause = makeNode(TableLikeClause);
 	CreateStmt                 *createStmt = makeNode(CreateStmt);
 	List                       *createStmts;
 	ListCell                   *lc;
+	bool                        session_sequences = false;
+	bool                        lazy_toast;
+	bool                        seeded;
+	uint64                      seed_rows = 0;
+	GttRegistryOptions          options;
 
 	elog(DEBUG1, "creating a temporary table like table with Oid %d", parent_relid);
 
-	/* Lock parent and check if it exists */
-	LockRelationOid(parent_relid, ShareUpdateExclusiveLock);
+	/* The partitions are created with the whole partition tree of the GTT */
+	if (!in_partition_tree && get_rel_relispartition(parent_relid))
+		return gtt_instantiate_partition_tree(pstate, parent_relid);
+
+	/*
+	 * Lock parent and check if it exists. The lock only has to prevent the
+	 * "template" from being dropped or altered, it must not conflict with
+	 * itself: the sessions instantiating the same GTT must not queue.
+	 */
+	parent_locked = gtt_relation_locked_by_me(parent_relid, AccessShareLock);
+	LockRelationOid(parent_relid, AccessShareLock);
 	if (!SearchSysCacheExists1(RELOID, ObjectIdGetDatum(parent_relid)))
 		elog(ERROR, "relation %u does not exist", parent_relid);
 
@@ -2072,6 +7273,30 @@ create_temporary_table_internal(ParseState *pstate, Oid parent_relid, bool prese
 	parent_nsp = get_rel_namespace(parent_relid);
 	parent_nsp_name = get_namespace_name(parent_nsp);
 	parent_persistence = get_rel_persistence(parent_relid);
+	parent_relkind = get_rel_relkind(parent_relid);
+
+	/* The options of the GTT, the seeded option may be changed by another session */
+	gtt_read_registry_options(parent_relid, &options);
+
+	/*
+	 * The tables of a partition tree are not followed by the session, they
+	 * get their TOAST table at once.
+	 */
+	lazy_toast = pgtt_lean_instantiation && !in_partition_tree
+						&& parent_relkind != RELKIND_PARTITIONED_TABLE;
+
+	/* The rows of a seeded GTT may need the TOAST table */
+	seeded = !in_partition_tree && parent_relkind == RELKIND_RELATION
+						&& options.seeded;
+	if (seeded && copy_seed)
+		lazy_toast = false;
+
+	/*
+	 * The identity columns of a partition tree share the sequence of the
+	 * root, they keep it.
+	 */
+	session_sequences = pgtt_session_sequences && !in_partition_tree
+						&& parent_relkind != RELKIND_PARTITIONED_TABLE;
 
 	/* Make up parent's RangeVar */
 	parent_rv = makeRangeVar(parent_nsp_name, parent_name, -1);
@@ -2092,13 +7317,23 @@ create_temporary_table_internal(ParseState *pstate, Oid parent_relid, bool prese
 	like_clause->options             = CREATE_TABLE_LIKE_DEFAULTS
 						| CREATE_TABLE_LIKE_INDEXES
 						| CREATE_TABLE_LIKE_CONSTRAINTS
+						| CREATE_TABLE_LIKE_STORAGE
 #if (PG_VERSION_NUM >= 100000)
 						| CREATE_TABLE_LIKE_IDENTITY
 #endif
 #if (PG_VERSION_NUM >= 120000)
 						| CREATE_TABLE_LIKE_GENERATED
+#endif
+#if (PG_VERSION_NUM >= 140000)
+						| CREATE_TABLE_LIKE_COMPRESSION
 #endif
 						| CREATE_TABLE_LIKE_COMMENTS;
+	/* The identity columns take a session-local counter, not a new sequence */
+	if (session_sequences)
+		like_clause->options &= ~CREATE_TABLE_LIKE_IDENTITY;
+	/* The comments can be read on the "template" table */
+	if (pgtt_lean_instantiation)
+		like_clause->options &= ~CREATE_TABLE_LIKE_COMMENTS;
 
 	elog(DEBUG1, "Initialize CreateStmt structure");
 	/* Initialize CreateStmt structure */
@@ -2109,16 +7344,32 @@ create_temporary_table_internal(ParseState *pstate, Oid parent_relid, bool prese
 	createStmt->inhRelations        = NIL;
 	createStmt->ofTypename          = NULL;
 	createStmt->constraints         = NIL;
-	createStmt->options             = NIL;
+	/* LIKE does not copy the storage parameters, fillfactor, etc. */
+	createStmt->options             = gtt_template_reloptions(parent_relid);
 #if (PG_VERSION_NUM >= 120000)
-	createStmt->accessMethod        = NULL;
+	/* NULL for the default_table_access_method */
+	createStmt->accessMethod        = options.access_method;
 #endif
 	if (preserved)
 		createStmt->oncommit    = ONCOMMIT_PRESERVE_ROWS;
 	else
 		createStmt->oncommit    = ONCOMMIT_DELETE_ROWS;
-	createStmt->tablespacename      = NULL;
+	/* NULL for the temp_tablespaces */
+	createStmt->tablespacename      = gtt_choose_tablespace(parent_relid, options.tablespace);
 	createStmt->if_not_exists       = false;
+	/*
+	 * A partitioned table has no rows of its own, its partitions are
+	 * emptied at commit, and it can not have an access method before
+	 * PostgreSQL 17. Its tablespace is only a default for the partitions,
+	 * they have their own.
+	 */
+	if (parent_relkind == RELKIND_PARTITIONED_TABLE)
+	{
+		createStmt->partspec    = gtt_template_partspec(parent_relid);
+		createStmt->accessMethod = NULL;
+		createStmt->oncommit    = ONCOMMIT_PRESERVE_ROWS;
+		createStmt->tablespacename = NULL;
+	}
 
 	elog(DEBUG1, "Obtain the sequence of Stmts to create temporary table");
 	/* Obtain the sequence of Stmts to create temporary table */
@@ -2134,12 +7385,6 @@ create_temporary_table_internal(ParseState *pstate, Oid parent_relid, bool prese
 		elog(DEBUG1, "Processing statement of type %d", nodeTag(cur_stmt));
 		if (IsA(cur_stmt, CreateStmt))
 		{
-			Datum           toast_options;
-#if PG_VERSION_NUM < 180000
-			static char     *validnsps[] = HEAP_RELOPT_NAMESPACES;
-#else
-			const char     *validnsps[] = HEAP_RELOPT_NAMESPACES;
-#endif
 			Oid             temp_relowner;
 
 			/* Temporary table owner must be current user */
@@ -2158,26 +7403,19 @@ create_temporary_table_internal(ParseState *pstate, Oid parent_relid, bool prese
 			/* Update config one more time */
 			CommandCounterIncrement();
 
-			/*
-			 * parse and validate reloptions for the toast
-			 * table
-			 */
-			toast_options = transformRelOptions((Datum) 0,
-									((CreateStmt *) cur_stmt)->options,
-									"toast",
-									validnsps,
-									true,
-									false);
-
-			(void) heap_reloptions(RELKIND_TOASTVALUE, toast_options, true);
-
-			NewRelationCreateToastTable(temp_relid, toast_options);
+			/* With the lean profile it is created by the first write */
+			if (!lazy_toast)
+				gtt_create_toast_table(temp_relid, ((CreateStmt *) cur_stmt)->options);
                 }
 		else if (IsA(cur_stmt, IndexStmt))
 		{
 			Oid                     relid;
 			elog(DEBUG1, "execution statement CREATE INDEX, relation has an index.");
 
+			/* the indexes follow the temporary table */
+			if (((IndexStmt *) cur_stmt)->tableSpace == NULL)
+				((IndexStmt *) cur_stmt)->tableSpace = createStmt->tablespacename;
+
 			relid =
 				RangeVarGetRelidExtended(((IndexStmt *) cur_stmt)->relation, ShareLock,
 #if (PG_VERSION_NUM >= 110000)
@@ -2245,15 +7483,77 @@ create_temporary_table_internal(ParseState *pstate, Oid parent_relid, bool prese
 			CommandCounterIncrement();
         }
 
+	/* Create and attach the partitions before the triggers are cloned to them */
+	if (OidIsValid(temp_relid) && parent_relkind == RELKIND_PARTITIONED_TABLE)
+		gtt_attach_partitions(pstate, parent_relid, temp_relid);
+
+	if (OidIsValid(temp_relid) && session_sequences)
+		gtt_set_session_sequences(parent_relid, parent_rv->relname);
+
+	/* Copied before the triggers, they are not fired for the initial rows */
+	if (OidIsValid(temp_relid) && seeded && copy_seed)
+		seed_rows = gtt_copy_seed_rows(parent_relid, temp_relid);
+
 	/*
 	 * CREATE TABLE ... (LIKE ...) does not copy the triggers, they must be
 	 * replicated on the temporary table by hand. See issue #52.
 	 */
 	if (OidIsValid(temp_relid))
-		gtt_copy_triggers(parent_relid, parent_rv->relname);
+		gtt_copy_triggers(parent_relid, temp_relid, parent_rv->relname);
+
+	/*
+	 * Register the temporary table in the session state. The rows of the
+	 * partitions are inserted through their parent, they are not counted
+	 * and the tables of a partition tree are left out.
+	 */
+	if (OidIsValid(temp_relid) && !in_partition_tree
+			&& parent_relkind != RELKIND_PARTITIONED_TABLE)
+	{
+		Relation parent_rel = table_open(parent_relid, NoLock);
+
+		gtt_register_session_rel(parent_rel, temp_relid, preserved, true);
+		table_close(parent_rel, NoLock);
+
+		gtt_apply_registry_options((GttSessionRel *) hash_search(GttSessionRelTable,
+											&temp_relid, HASH_FIND, NULL), &options);
+
+		((GttSessionRel *) hash_search(GttSessionRelTable, &temp_relid,
+								HASH_FIND, NULL))->lazy_toast = lazy_toast;
+
+		if (seeded)
+		{
+			GttSessionRel *srel = (GttSessionRel *) hash_search(GttSessionRelTable,
+											&temp_relid, HASH_FIND, NULL);
+
+			srel->seeded = true;
+			srel->tuples = seed_rows;
+			srel->tuples_valid = true;
+			srel->xact_changed = true;
+			srel->xact_inserted += seed_rows;
+			srel->changes_since_analyze += seed_rows;
+		}
+
+		if (pgtt_learn_statistics)
+			gtt_load_learned_statistics((GttSessionRel *) hash_search(GttSessionRelTable,
+											&temp_relid, HASH_FIND, NULL));
+
+		/*
+		 * Queries executed just after a bulk load will be planned with the
+		 * representative statistics of the GTT instead of no statistics.
+		 */
+		if (pgtt_seed_statistics && gtt_copy_statistics(parent_relid, temp_relid) > 0)
+			CommandCounterIncrement();
+	}
 
-	/* release lock on "template" relation */
-	UnlockRelationOid(parent_relid, ShareUpdateExclusiveLock);
+	/*
+	 * Release the locks on the "template" relation, including the ones
+	 * taken by the LIKE clause, the temporary table does not depend on it.
+	 * When the statement had already locked it only ours is released.
+	 */
+	if (parent_locked)
+		UnlockRelationOid(parent_relid, AccessShareLock);
+	else
+		gtt_unlock_relation_all(parent_relid, AccessShareLock);
 
 	elog(DEBUG1, "Create a temporary table done with Oid: %d", temp_relid);
 	return temp_relid;
@@ -2278,6 +7578,29 @@ gtt_post_parse_analyze(ParseState *pstate, Query *query)
 	/* Try to load pgtt if not already done. */
 	gtt_try_load();
 
+	/* The storage of the tables emptied or dropped is now released */
+	if (gtt_release_pending && NOT_IN_PARALLEL_WORKER)
+		(void) gtt_release_local_buffers();
+
+	/* Release the memory of the GTT removed from the cache */
+	gtt_compact_hash_table();
+
+	/*
+	 * Apply the changes made on the "template" tables by other sessions
+	 * before the query is planned, new indexes can be used right away.
+	 */
+	if (NOT_IN_PARALLEL_WORKER && pgtt_is_enabled && (gtt_ddl_pending || gtt_ddl_failed)
+			&& !(query->commandType == CMD_UTILITY
+				&& IsA(query->utilityStmt, TransactionStmt)))
+		gtt_sync_pending_tables();
+
+	/* The seeded option of a GTT has been changed */
+	if (NOT_IN_PARALLEL_WORKER && pgtt_is_enabled && gtt_seeded_pending
+			&& GttHashTable != NULL && IsTransactionState()
+			&& !(query->commandType == CMD_UTILITY
+				&& IsA(query->utilityStmt, TransactionStmt)))
+		gtt_refresh_seeded();
+
 	/*
 	 * Reroute all the references to a GTT "template" table found in the
 	 * query tree, including the ones in sub-queries, CTE and sub-links,
@@ -2296,6 +7619,83 @@ gtt_post_parse_analyze(ParseState *pstate, Query *query)
 	}
 }
 
+/*
+ * Return true if the current transaction holds a lock on the relation
+ * in the given mode.
+ */
+static bool
+gtt_relation_locked_by_me(Oid relid, LOCKMODE lockmode)
+{
+	LOCKTAG tag;
+
+	SET_LOCKTAG_RELATION(tag, MyDatabaseId, relid);
+
+	return GTT_LOCK_HELD_BY_ME(&tag, lockmode);
+}
+
+/*
+ * Release all the locks held in the given mode on a relation, whatever
+ * the number of times it has been locked in the transaction.
+ */
+static void
+gtt_unlock_relation_all(Oid relid, LOCKMODE lockmode)
+{
+	LOCKTAG tag;
+
+	SET_LOCKTAG_RELATION(tag, MyDatabaseId, relid);
+
+	while (GTT_LOCK_HELD_BY_ME(&tag, lockmode)
+			&& LockRelease(&tag, lockmode, false))
+		;
+}
+
+/*
+ * Create the temporary table of a GTT found in the cache if it does not
+ * exist yet and flag the cache entry as created. The temporary table of
+ * a seeded GTT is created empty when copy_seed is false.
+ */
+static void
+gtt_instantiate(ParseState *pstate, Gtt *gtt, bool copy_seed)
+{
+	/* After an error and rollback the table is still registered in cache but must be initialized */
+	if (gtt->created && OidIsValid(gtt->temp_relid)
+			&& !SearchSysCacheExists1(RELOID, ObjectIdGetDatum(gtt->temp_relid))
+			)
+	{
+		elog(DEBUG1, "invalid temporary table with relid %d (%s), reseting.", gtt->temp_relid, gtt->relname);
+		gtt_forget_session_rel(gtt->temp_relid);
+		gtt->created = false;
+		gtt->temp_relid = 0;
+	}
+
+	if (gtt->created)
+	{
+		gtt_touch_session_rel(gtt->temp_relid);
+		return;
+	}
+
+	/* Make room for the new temporary table */
+	if (pgtt_max_instantiated > 0)
+		gtt_evict_session_rels();
+
+	elog(DEBUG1, "global temporary table from relid %d does not exists create it: %s", gtt->relid, gtt->relname);
+	/* Call create temporary table */
+	if ((gtt->temp_relid = create_temporary_table_internal(pstate, gtt->relid, gtt->preserved, false, copy_seed)) != InvalidOid)
+	{
+		elog(DEBUG1, "global temporary table %s (oid: %d) created", gtt->relname, gtt->temp_relid);
+		/* Update hash list with table flagged as created*/
+		gtt->created = true;
+		GttHashTableDelete(gtt->relname);
+		GttHashTableInsert(*gtt, gtt->relname);
+
+		/* The cached plans reading the "template" of a seeded GTT are obsolete */
+		if (gtt->seeded)
+			ResetPlanCache();
+	}
+	else
+		elog(ERROR, "can not create global temporary table %s", gtt->relname);
+}
+
 /*
  * Reroute a single range table entry to the temporary table backing the
  * global temporary table, when the relation is a GTT "template" table.
@@ -2310,10 +7710,22 @@ gtt_rewrite_rte(ParseState *pstate, Query *query, RangeTblEntry *rte)
 
 	/* This must be a valid relation not from pg_catalog */
 	if (rte->rtekind != RTE_RELATION || rte->relid == InvalidOid
-			|| rte->relkind != RELKIND_RELATION
+			|| (rte->relkind != RELKIND_RELATION
+				&& rte->relkind != RELKIND_PARTITIONED_TABLE)
 			|| is_catalog_relid(rte->relid))
 		return;
 
+	/*
+	 * Fast path: the "template" tables are all in the extension schema,
+	 * once the temporary table exists an unqualified name is resolved to
+	 * it directly as pg_temp is searched first.
+	 */
+	if (get_rel_namespace(rte->relid) != pgtt_namespace_oid)
+	{
+		gtt_touch_session_rel(rte->relid);
+		return;
+	}
+
 #if (PG_VERSION_NUM >= 120000)
 	rel = table_open(rte->relid, NoLock);
 #else
@@ -2332,6 +7744,7 @@ gtt_rewrite_rte(ParseState *pstate, Query *query, RangeTblEntry *rte)
 	gtt.preserved = false;
 	gtt.code = NULL;
 	gtt.created = false;
+	gtt.seeded = false;
 
 	/* Check if the table is in the hash list and it has not already be created */
 	if ((const void*)name != NULL)
@@ -2349,32 +7762,19 @@ gtt_rewrite_rte(ParseState *pstate, Query *query, RangeTblEntry *rte)
 		return;
 	}
 
-	/* After an error and rollback the table is still registered in cache but must be initialized */
-	if (gtt.created && OidIsValid(gtt.temp_relid)
-			&& !SearchSysCacheExists1(RELOID, ObjectIdGetDatum(gtt.temp_relid))
-			)
+	/*
+	 * A seeded GTT is read from its "template" table until the session
+	 * writes to it, the temporary table is then created with a copy of
+	 * the rows of the "template".
+	 */
+	if (gtt.seeded && !gtt.created && rte->rellockmode == AccessShareLock)
 	{
-		elog(DEBUG1, "invalid temporary table with relid %d (%s), reseting.", gtt.temp_relid, gtt.relname);
-		gtt.created = false;
-		gtt.temp_relid = 0;
+		elog(DEBUG1, "reading seeded GTT table \"%s\" from its template", name);
+		return;
 	}
 
 	/* Create the temporary table if it does not exists */
-	if (!gtt.created)
-	{
-		elog(DEBUG1, "global temporary table from relid %d does not exists create it: %s", rte->relid, gtt.relname);
-		/* Call create temporary table */
-		if ((gtt.temp_relid = create_temporary_table_internal(pstate, gtt.relid, gtt.preserved)) != InvalidOid)
-		{
-			elog(DEBUG1, "global temporary table %s (oid: %d) created", gtt.relname, gtt.temp_relid);
-			/* Update hash list with table flagged as created*/
-			gtt.created = true;
-			GttHashTableDelete(gtt.relname);
-			GttHashTableInsert(gtt, gtt.relname);
-		}
-		else
-			elog(ERROR, "can not create global temporary table %s", gtt.relname);
-	}
+	gtt_instantiate(pstate, &gtt, true);
 
 	elog(DEBUG1, "temporary table exists with oid %d", gtt.temp_relid);
 
@@ -2392,8 +7792,17 @@ gtt_rewrite_rte(ParseState *pstate, Query *query, RangeTblEntry *rte)
 			rteperm->relid = gtt.temp_relid;
 		}
 #endif
+		/*
+		 * The parse analysis has locked the "template" table for this
+		 * reference, no part of the statement will use it: release that
+		 * lock only, the locks taken before by the transaction (LOCK
+		 * TABLE, cursors, ...) are kept. When the "template" is not used
+		 * otherwise it is then not locked for the rest of the transaction,
+		 * it does not use a fast-path lock slot nor blocks the DDL on the
+		 * GTT.
+		 */
 		LockRelationOid(gtt.temp_relid, rte->rellockmode);
-		if (rte->rellockmode != AccessShareLock)
+		if (gtt_relation_locked_by_me(rte->relid, rte->rellockmode))
 			UnlockRelationOid(rte->relid, rte->rellockmode);
 
 		elog(DEBUG1, "rerouting relid %d access to %d for GTT table \"%s\"", rte->relid, gtt.temp_relid, name);
@@ -2630,12 +8039,14 @@ gtt_update_registered_table(Gtt gtt)
 
 /*
  * Create the temporary table related to a Global Temporary Table
- * and register the GTT in pg_global_temp_tables table.
- *
+ * and register the GTT in pg_global_temp_tables table. The query
+ * is the statement following the AS keyword without WITH [NO] DATA.
  */
 static void
-gtt_create_table_as(Gtt gtt, bool skipdata)
+gtt_create_table_as(Gtt gtt, const char *query, bool skipdata, IntoClause *into)
 {
+	char    *access_method = into->accessMethod;
+	char    *tablespace = into->tableSpaceName;
 	char    *newQueryString = NULL;
 	int     connected = 0;
 	int     finished = 0;
@@ -2649,12 +8060,20 @@ gtt_create_table_as(Gtt gtt, bool skipdata)
 	/* This can only be called if GTT has been properly loaded. */
 	Assert(GttHashTable != NULL);
 
+	if (access_method != NULL)
+		(void) gtt_check_registry_option("access_method", access_method, NULL, ERROR);
+	if (tablespace != NULL)
+		(void) gtt_check_registry_option("tablespace", quote_identifier(tablespace), NULL, ERROR);
+
 	connected = SPI_connect();
 	if (connected != SPI_OK_CONNECT)
 		ereport(ERROR, (errmsg("could not connect to SPI manager")));
 
-	/* Create the "template" table */
-	newQueryString = psprintf("CREATE UNLOGGED TABLE %s.%s %s;",
+	/*
+	 * Create the "template" table, it must stay empty so the query is not
+	 * executed: the table is built from its result descriptor.
+	 */
+	newQueryString = psprintf("CREATE UNLOGGED TABLE %s.%s %s WITH NO DATA;",
 			quote_identifier(pgtt_namespace_name),
 			quote_identifier(gtt.relname),
 			gtt.code);
@@ -2687,6 +8106,7 @@ gtt_create_table_as(Gtt gtt, bool skipdata)
 	if (!skipdata)
 	{
 		char namespaceName[NAMEDATALEN];
+		bool bulk_load;
 
 		/* Get current temporary namespace name */
 		snprintf(namespaceName, sizeof(namespaceName), "pg_temp_%d",
@@ -2697,9 +8117,22 @@ gtt_create_table_as(Gtt gtt, bool skipdata)
 #endif
 				);
 
-		newQueryString = psprintf("CREATE TEMPORARY TABLE %s %s WITH DATA",
+		/*
+		 * When the query is not an EXECUTE the temporary table is created
+		 * empty and filled by an INSERT ... SELECT that can use the frozen
+		 * multi-insert path. Either way the query is executed once, for
+		 * the temporary table.
+		 */
+		bulk_load = (pg_strncasecmp(query, "EXECUTE", 7) != 0);
+
+		newQueryString = psprintf("CREATE TEMPORARY TABLE %s%s%s%s%s %s %s",
 				quote_identifier(gtt.relname),
-				gtt.code);
+				(access_method != NULL) ? " USING " : "",
+				(access_method != NULL) ? quote_identifier(access_method) : "",
+				(tablespace != NULL) ? " TABLESPACE " : "",
+				(tablespace != NULL) ? quote_identifier(tablespace) : "",
+				gtt.code,
+				(bulk_load) ? "WITH NO DATA" : "WITH DATA");
 		result = SPI_exec(newQueryString, 0);
 		if (result < 0)
 			ereport(ERROR, (errmsg("execution failure on query: \"%s\"", newQueryString)));
@@ -2723,6 +8156,26 @@ gtt_create_table_as(Gtt gtt, bool skipdata)
 					(errmsg("can not get OID of newly created temporary table %s",
 								quote_identifier(gtt.relname))));
 		gtt.created = true;
+
+		/* Register the temporary table in the session state */
+		{
+			Relation parent_rel = table_open(gtt.relid, AccessShareLock);
+
+			/* the number of rows inserted by CREATE TABLE AS is not known */
+			gtt_register_session_rel(parent_rel, gtt.temp_relid, gtt.preserved, bulk_load);
+			table_close(parent_rel, AccessShareLock);
+		}
+
+		if (bulk_load)
+		{
+			newQueryString = psprintf("INSERT INTO %s.%s %s",
+					quote_identifier(namespaceName),
+					quote_identifier(gtt.relname),
+					query);
+			result = SPI_exec(newQueryString, 0);
+			if (result < 0)
+				ereport(ERROR, (errmsg("execution failure on query: \"%s\"", newQueryString)));
+		}
 	}
 
 	/* Now register the GTT table */
@@ -2737,31 +8190,69 @@ gtt_create_table_as(Gtt gtt, bool skipdata)
 	result = SPI_exec(newQueryString, 0);
 	if (result < 0)
 		ereport(ERROR, (errmsg("can not registrer new global temporary table")));
+	gtt_learned_statistics_row(gtt.relid, true);
 
 	finished = SPI_finish();
 	if (finished != SPI_OK_FINISH)
 		ereport(ERROR, (errmsg("could not disconnect from SPI manager")));
 
+	/* USING and TABLESPACE are recorded in the registry for the temporary tables */
+	if (access_method != NULL)
+		gtt_store_registry_option(gtt.relid, "access_method", access_method);
+	if (tablespace != NULL)
+		gtt_store_registry_option(gtt.relid, "tablespace", quote_identifier(tablespace));
+
 	/* registrer the table in the cache */
 	GttHashTableDelete(gtt.relname);
 	GttHashTableInsert(gtt, gtt.relname);
 }
 
-int
-strremovestr(char *src, char *toremove)
+/*
+ * Return the position of keyword when it is the last word of the first
+ * len characters of str, -1 otherwise. The match is case insensitive.
+ */
+static int
+gtt_trailing_keyword(const char *str, int len, const char *keyword)
 {
-	while( *src )
-	{
-		char *k=toremove,*s=src;
-		while( *k && *k==*s ) ++k,++s;
-		if( !*k )
-		{
-			while( *s ) *src++=*s++;
-			*src=0;
-			return 1;
-		}
-		++src;
-	}
-	return 0;
+	int klen = strlen(keyword);
+
+	while (len > 0 && isspace((unsigned char) str[len - 1]))
+		len--;
+	if (len <= klen || pg_strncasecmp(str + len - klen, keyword, klen) != 0)
+		return -1;
+	if (isalnum((unsigned char) str[len - klen - 1]) || str[len - klen - 1] == '_')
+		return -1;
+
+	return len - klen;
+}
+
+/*
+ * Remove the trailing semicolon and WITH [NO] DATA clause from the query
+ * of a CREATE TABLE AS statement.
+ */
+static void
+gtt_strip_with_data(char *query)
+{
+	int len = strlen(query);
+	int pos;
+	int nopos;
+
+	while (len > 0 && (query[len - 1] == ';' || isspace((unsigned char) query[len - 1])))
+		query[--len] = '\0';
+
+	pos = gtt_trailing_keyword(query, len, "DATA");
+	if (pos < 0)
+		return;
+	nopos = gtt_trailing_keyword(query, pos, "NO");
+	if (nopos >= 0)
+		pos = nopos;
+	pos = gtt_trailing_keyword(query, pos, "WITH");
+	if (pos < 0)
+		return;
+
+	len = pos;
+	while (len > 0 && isspace((unsigned char) query[len - 1]))
+		len--;
+	query[len] = '\0';
 }
 
@@ -87,12 +87,13 @@ INSERT INTO t_glob_temptable2 VALUES (2, 'two');
 
 SELECT * FROM t_glob_temptable2 WHERE id = 2;
 
--- Rename the table when the temporary table has already been created is not allowed
+-- Rename the table when the temporary table has already been created,
+-- the temporary table is renamed too and keeps its rows
 ALTER TABLE t_glob_temptable2 RENAME TO t_glob_temptable1;
 
-\c - -
+SELECT * FROM t_glob_temptable1 ORDER BY id;
 
-ALTER TABLE t_glob_temptable2 RENAME TO t_glob_temptable1;
+\c - -
 
 -- Look if the renaming is effective
 SELECT n.nspname, c.relname FROM pg_class c JOIN pg_namespace n ON (c.relnamespace=n.oid) WHERE relname = 't_glob_temptable1';
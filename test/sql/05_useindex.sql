@@ -55,6 +55,7 @@ INSERT INTO t_glob_temptable1 VALUES (2, 'two');
 
 -- Verify that the index is used
 SET enable_bitmapscan TO off;
+SET enable_seqscan TO off;
 EXPLAIN (COSTS OFF) SELECT * FROM t_glob_temptable1 WHERE id = 2;
 
 -- Reconnect and drop it
@@ -68,7 +69,8 @@ CREATE /*GLOBAL*/ TEMPORARY TABLE t_glob_temptable2 (id integer, lbl text) ON CO
 
 CREATE INDEX ON t_glob_temptable2 (id);
 SELECT * FROM t_glob_temptable2;
--- Must complain that the GTT is in use
+-- The GTT is in use, the index is created on the "template" table
+-- and on the temporary table
 CREATE INDEX ON t_glob_temptable2 (lbl);
 
 SELECT pg_catalog.pg_get_indexdef(i.indexrelid, 0, true)
@@ -76,6 +78,7 @@ FROM pg_catalog.pg_class c, pg_catalog.pg_class c2, pg_catalog.pg_index i
 LEFT JOIN pg_catalog.pg_constraint con ON (conrelid = i.indrelid AND conindid = i.indexrelid AND contype IN ('p','u','x'))
 WHERE c.oid = 'pgtt_schema.t_glob_temptable2'::regclass::oid AND c.oid = i.indrelid AND i.indexrelid = c2.oid
 ORDER BY i.indisprimary DESC, c2.relname;
+SELECT indexname FROM pg_indexes WHERE tablename = 't_glob_temptable2' and schemaname LIKE 'pg_temp_%' ORDER BY indexname;
 
 -- Check that we do not break LIKE ... USING INDEXES
 CREATE TABLE tb_with_index (id integer PRIMARY KEY, lbl varchar);
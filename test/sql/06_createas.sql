@@ -45,3 +45,12 @@ SELECT * FROM t_glob_temptable1 ORDER BY id;
 
 -- Cleanup
 DROP TABLE t_glob_temptable1;
+
+-- Lower case WITH [NO] DATA clauses are removed from the query too
+CREATE GLOBAL TEMPORARY TABLE t_glob_temptable2 as select id from source with no data;
+SELECT code FROM pgtt_schema.pg_global_temp_tables WHERE relname = 't_glob_temptable2';
+SELECT count(*) FROM t_glob_temptable2;
+DROP TABLE t_glob_temptable2;
+CREATE GLOBAL TEMPORARY TABLE t_glob_temptable2 as select id from source with data;
+SELECT count(*) FROM t_glob_temptable2;
+DROP TABLE t_glob_temptable2;
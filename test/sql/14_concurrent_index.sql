@@ -19,19 +19,17 @@ CREATE GLOBAL TEMPORARY TABLE my_gtt_concurrent (
 -- This forces the namespace check in pgtt.c to see a "pg_temp" namespace.
 INSERT INTO my_gtt_concurrent VALUES (1, 'initial_data');
 
--- 3. Negative Test: Standard CREATE INDEX
--- This should still FAIL because the GTT is active and we are not using CONCURRENTLY.
--- The extension preserves the error here: if (!stmt->concurrent) ereport(ERROR...
-\set ON_ERROR_STOP 0
-CREATE INDEX idx_gtt_fail ON my_gtt_concurrent (id);
-\set ON_ERROR_STOP 1
-
--- 4. Positive Test: CREATE INDEX CONCURRENTLY
--- This should SUCCEED. The extension bypasses the error when stmt->concurrent is true
--- and uses ShareUpdateExclusiveLock.
+-- 3. Standard CREATE INDEX
+-- The GTT is active, the index is created on the "template" table and
+-- then on the temporary table of the session.
+CREATE INDEX idx_gtt_std ON my_gtt_concurrent (id);
+
+-- 4. CREATE INDEX CONCURRENTLY
+-- Same as above but the relation is locked with ShareUpdateExclusiveLock.
 CREATE INDEX CONCURRENTLY idx_gtt_success ON my_gtt_concurrent (id);
 
--- Verify the index is actually there and valid
+-- Verify the indexes are actually there, on the "template" table
+-- and on the temporary table
 SELECT
     CASE
         WHEN schemaname LIKE 'pg_temp_%' THEN 'pg_temp'
@@ -0,0 +1,40 @@
+----
+-- Regression test to Global Temporary Table implementation
+--
+-- Test the automatic ANALYZE of the temporary table once enough
+-- rows have been changed. Autovacuum never processes temporary
+-- tables.
+--
+----
+
+SET pgtt.analyze_threshold TO 10;
+SET pgtt.analyze_scale_factor TO 0;
+
+CREATE /*GLOBAL*/ TEMPORARY TABLE t_glob_temptable1 (id integer, lbl text) ON COMMIT PRESERVE ROWS;
+
+-- Not enough changes, the temporary table has no statistics
+INSERT INTO t_glob_temptable1 SELECT i, 'row ' || i FROM generate_series(1, 5) i;
+SELECT count(*) FROM pg_stats WHERE schemaname LIKE 'pg_temp%' AND tablename = 't_glob_temptable1';
+
+-- The threshold is crossed, the temporary table must have been analyzed
+INSERT INTO t_glob_temptable1 SELECT i, 'row ' || i FROM generate_series(6, 20) i;
+SELECT count(*) FROM pg_stats WHERE schemaname LIKE 'pg_temp%' AND tablename = 't_glob_temptable1';
+SELECT reltuples FROM pg_class WHERE oid = 'pg_temp.t_glob_temptable1'::regclass;
+
+-- The threshold can be set per GTT on the "template" table
+\c - -
+ALTER TABLE pgtt_schema.t_glob_temptable1 SET (autovacuum_analyze_threshold = 100);
+INSERT INTO t_glob_temptable1 SELECT i, 'row ' || i FROM generate_series(1, 20) i;
+SELECT count(*) FROM pg_stats WHERE schemaname LIKE 'pg_temp%' AND tablename = 't_glob_temptable1';
+
+-- Or disabled
+\c - -
+ALTER TABLE pgtt_schema.t_glob_temptable1 SET (autovacuum_analyze_threshold = 10, autovacuum_enabled = false);
+INSERT INTO t_glob_temptable1 SELECT i, 'row ' || i FROM generate_series(1, 200) i;
+SELECT count(*) FROM pg_stats WHERE schemaname LIKE 'pg_temp%' AND tablename = 't_glob_temptable1';
+
+-- Reconnect and drop it
+\c - -
+
+-- Cleanup
+DROP TABLE t_glob_temptable1;
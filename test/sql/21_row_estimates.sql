@@ -0,0 +1,58 @@
+----
+-- Regression test to Global Temporary Table implementation
+--
+-- Test that the planner sees the exact number of rows of the
+-- temporary table, counted by the extension on INSERT, DELETE
+-- and TRUNCATE, instead of an estimate based on its size.
+--
+----
+
+-- Return the number of rows estimated by the planner
+CREATE FUNCTION plan_rows(query text) RETURNS integer AS $$
+DECLARE
+    plan json;
+BEGIN
+    EXECUTE 'EXPLAIN (FORMAT JSON) ' || query INTO plan;
+    RETURN (plan->0->'Plan'->>'Plan Rows')::float8::integer;
+END
+$$ LANGUAGE plpgsql;
+
+CREATE /*GLOBAL*/ TEMPORARY TABLE t_glob_temptable1 (id integer, lbl text) ON COMMIT PRESERVE ROWS;
+
+-- Rows inserted are counted
+INSERT INTO t_glob_temptable1 SELECT i, 'row ' || i FROM generate_series(1, 100) i;
+SELECT plan_rows('SELECT * FROM t_glob_temptable1');
+
+-- Rows deleted too, not the rows updated
+DELETE FROM t_glob_temptable1 WHERE id <= 40;
+UPDATE t_glob_temptable1 SET lbl = 'updated';
+SELECT plan_rows('SELECT * FROM t_glob_temptable1');
+
+-- Rollback restores the number of rows
+BEGIN;
+INSERT INTO t_glob_temptable1 SELECT i, 'row ' || i FROM generate_series(1, 50) i;
+SELECT plan_rows('SELECT * FROM t_glob_temptable1');
+
+ROLLBACK;
+SELECT plan_rows('SELECT * FROM t_glob_temptable1');
+
+-- The temporary table is empty after a TRUNCATE
+TRUNCATE t_glob_temptable1;
+SELECT plan_rows('SELECT * FROM t_glob_temptable1');
+
+-- And at commit with ON COMMIT DELETE ROWS
+CREATE /*GLOBAL*/ TEMPORARY TABLE t_glob_temptable2 (id integer) ON COMMIT DELETE ROWS;
+BEGIN;
+INSERT INTO t_glob_temptable2 SELECT i FROM generate_series(1, 30) i;
+SELECT plan_rows('SELECT * FROM t_glob_temptable2');
+
+COMMIT;
+SELECT plan_rows('SELECT * FROM t_glob_temptable2');
+
+-- Reconnect and drop it
+\c - -
+
+-- Cleanup
+DROP TABLE t_glob_temptable1;
+DROP TABLE t_glob_temptable2;
+DROP FUNCTION plan_rows(text);
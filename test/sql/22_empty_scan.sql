@@ -0,0 +1,64 @@
+----
+-- Regression test to Global Temporary Table implementation
+--
+-- Test that the scans of a temporary table known to be empty are
+-- removed from the plan and that the plans are invalidated when
+-- rows are added.
+--
+----
+
+-- Return the number of scans of a relation in the plan
+CREATE FUNCTION plan_scans(query text, relname text) RETURNS integer AS $$
+DECLARE
+    plan text;
+BEGIN
+    EXECUTE 'EXPLAIN (FORMAT JSON) ' || query INTO plan;
+    RETURN (SELECT count(*) FROM regexp_matches(plan, '"Relation Name": "' || relname || '"', 'g'));
+END
+$$ LANGUAGE plpgsql;
+
+CREATE /*GLOBAL*/ TEMPORARY TABLE t_glob_temptable1 (id integer, lbl text) ON COMMIT PRESERVE ROWS;
+CREATE TABLE t_regular (id integer, lbl text);
+INSERT INTO t_regular SELECT i, 'row ' || i FROM generate_series(1, 10) i;
+
+-- Never written, the temporary table is not scanned
+SELECT count(*) FROM t_glob_temptable1;
+
+SELECT plan_scans('SELECT * FROM t_glob_temptable1', 't_glob_temptable1');
+
+SELECT plan_scans('SELECT * FROM t_regular r LEFT JOIN t_glob_temptable1 g ON g.id = r.id', 't_glob_temptable1');
+
+SELECT count(*) FROM t_regular r LEFT JOIN t_glob_temptable1 g ON g.id = r.id;
+
+PREPARE q AS SELECT count(*) FROM t_glob_temptable1;
+EXECUTE q;
+
+-- The cached plan must see the new rows
+INSERT INTO t_glob_temptable1 SELECT i, 'row ' || i FROM generate_series(1, 3) i;
+EXECUTE q;
+
+SELECT plan_scans('SELECT * FROM t_glob_temptable1', 't_glob_temptable1');
+
+-- Or the rows restored by a rollback
+BEGIN;
+DELETE FROM t_glob_temptable1;
+DEALLOCATE q;
+PREPARE q AS SELECT count(*) FROM t_glob_temptable1;
+EXECUTE q;
+
+ROLLBACK;
+EXECUTE q;
+
+-- Empty again after a TRUNCATE
+TRUNCATE t_glob_temptable1;
+SELECT plan_scans('SELECT * FROM t_glob_temptable1', 't_glob_temptable1');
+
+EXECUTE q;
+
+-- Reconnect and drop it
+\c - -
+
+-- Cleanup
+DROP TABLE t_glob_temptable1;
+DROP TABLE t_regular;
+DROP FUNCTION plan_scans(text, text);
@@ -0,0 +1,35 @@
+----
+-- Regression test to Global Temporary Table implementation
+--
+-- Test the capture of the statistics of a temporary table on the
+-- "template" table and the seeding of the temporary tables created
+-- later with these statistics.
+--
+----
+
+CREATE /*GLOBAL*/ TEMPORARY TABLE t_glob_temptable1 (id integer, lbl text) ON COMMIT PRESERVE ROWS;
+
+-- Load representative data and capture its statistics
+INSERT INTO t_glob_temptable1 SELECT i, 'row ' || (i % 4) FROM generate_series(1, 100) i;
+SELECT pgtt_schema.pgtt_capture_statistics('t_glob_temptable1');
+
+SELECT attname, n_distinct FROM pg_stats WHERE schemaname = 'pgtt_schema' AND tablename = 't_glob_temptable1' ORDER BY attname;
+
+-- A new session gets these statistics when the temporary table is created
+\c - -
+SELECT count(*) FROM t_glob_temptable1;
+
+SELECT attname, n_distinct FROM pg_stats WHERE schemaname LIKE 'pg_temp%' AND tablename = 't_glob_temptable1' ORDER BY attname;
+
+-- Unless it is disabled
+\c - -
+SET pgtt.seed_statistics TO off;
+SELECT count(*) FROM t_glob_temptable1;
+
+SELECT count(*) FROM pg_stats WHERE schemaname LIKE 'pg_temp%' AND tablename = 't_glob_temptable1';
+
+-- Reconnect and drop it
+\c - -
+
+-- Cleanup
+DROP TABLE t_glob_temptable1;
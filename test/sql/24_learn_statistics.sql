@@ -0,0 +1,48 @@
+----
+-- Regression test to Global Temporary Table implementation
+--
+-- Test the statistics of the temporary tables shared between the
+-- sessions and used by the planner until the temporary table has
+-- been analyzed.
+--
+----
+
+-- Return the number of rows estimated by the planner
+CREATE FUNCTION plan_rows(query text) RETURNS integer AS $$
+DECLARE
+    plan json;
+BEGIN
+    EXECUTE 'EXPLAIN (FORMAT JSON) ' || query INTO plan;
+    RETURN (plan->0->'Plan'->>'Plan Rows')::float8::integer;
+END
+$$ LANGUAGE plpgsql;
+
+SET pgtt.learn_statistics TO on;
+SET pgtt.analyze_threshold TO 10;
+SET pgtt.analyze_scale_factor TO 0;
+
+CREATE /*GLOBAL*/ TEMPORARY TABLE t_glob_temptable1 (id integer, lbl text) ON COMMIT PRESERVE ROWS;
+
+-- The automatic ANALYZE publishes the statistics
+INSERT INTO t_glob_temptable1 SELECT i, 'row ' || (i % 4) FROM generate_series(1, 100) i;
+SELECT samples, tuples, ndistinct FROM pgtt_schema.pg_global_temp_stats WHERE relid = 'pgtt_schema.t_glob_temptable1'::regclass;
+
+-- A new session uses them before its own ANALYZE
+\c - -
+SET pgtt.learn_statistics TO on;
+SELECT count(*) FROM t_glob_temptable1;
+
+INSERT INTO t_glob_temptable1 SELECT i, 'row ' || i FROM generate_series(1, 5) i;
+SELECT plan_rows('SELECT DISTINCT lbl FROM t_glob_temptable1');
+
+SET pgtt.learn_statistics TO off;
+SELECT plan_rows('SELECT DISTINCT lbl FROM t_glob_temptable1');
+
+-- Reconnect and drop it
+\c - -
+
+-- Cleanup
+DROP TABLE t_glob_temptable1;
+SELECT count(*) FROM pgtt_schema.pg_global_temp_stats;
+
+DROP FUNCTION plan_rows(text);
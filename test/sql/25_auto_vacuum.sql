@@ -0,0 +1,38 @@
+----
+-- Regression test to Global Temporary Table implementation
+--
+-- Test that the pages of the temporary table loaded by a committed
+-- transaction are set all-visible so that index-only scans do not
+-- have to fetch the heap.
+--
+----
+
+-- Return the type of the top plan node and its number of heap fetches
+CREATE FUNCTION plan_heap_fetches(query text) RETURNS text AS $$
+DECLARE
+    plan json;
+BEGIN
+    EXECUTE 'EXPLAIN (ANALYZE, COSTS OFF, TIMING OFF, FORMAT JSON) ' || query INTO plan;
+    RETURN (plan->0->'Plan'->>'Node Type') || ': ' || (plan->0->'Plan'->>'Heap Fetches');
+END
+$$ LANGUAGE plpgsql;
+
+SET pgtt.auto_analyze TO off;
+SET pgtt.vacuum_threshold TO 100;
+SET enable_seqscan TO off;
+SET enable_bitmapscan TO off;
+
+CREATE /*GLOBAL*/ TEMPORARY TABLE t_glob_temptable1 (id integer, lbl text) ON COMMIT PRESERVE ROWS;
+CREATE INDEX ON t_glob_temptable1 (id);
+
+-- Load the temporary table
+INSERT INTO t_glob_temptable1 SELECT i, 'row ' || i FROM generate_series(1, 1000) i;
+
+-- The next query executed sets the visibility map
+SELECT count(*) FROM t_glob_temptable1;
+
+SELECT plan_heap_fetches('SELECT id FROM t_glob_temptable1 WHERE id <= 100');
+
+-- Cleanup
+DROP TABLE t_glob_temptable1;
+DROP FUNCTION plan_heap_fetches(text);
@@ -0,0 +1,65 @@
+----
+-- Regression test to Global Temporary Table implementation
+--
+-- Test the bulk load of the rows of an INSERT ... SELECT into a
+-- temporary table created or truncated in the current transaction.
+--
+----
+
+-- Return the number of rows estimated by the planner
+CREATE FUNCTION plan_rows(query text) RETURNS integer AS $$
+DECLARE
+    plan json;
+BEGIN
+    EXECUTE 'EXPLAIN (FORMAT JSON) ' || query INTO plan;
+    RETURN (plan->0->'Plan'->>'Plan Rows')::float8::integer;
+END
+$$ LANGUAGE plpgsql;
+
+CREATE /*GLOBAL*/ TEMPORARY TABLE t_glob_temptable1 (id integer NOT NULL CHECK (id > 0), lbl text) ON COMMIT PRESERVE ROWS;
+CREATE INDEX ON t_glob_temptable1 (id);
+
+-- The first INSERT creates the temporary table and loads it
+INSERT INTO t_glob_temptable1 SELECT i, 'row ' || i FROM generate_series(1, 2000) i;
+SELECT count(*), min(id), max(id) FROM t_glob_temptable1;
+
+SELECT plan_rows('SELECT * FROM t_glob_temptable1');
+
+-- The index entries are inserted too
+SET enable_seqscan TO off;
+SELECT lbl FROM t_glob_temptable1 WHERE id = 1500;
+
+SET enable_seqscan TO on;
+
+-- The constraints are checked
+BEGIN;
+TRUNCATE t_glob_temptable1;
+INSERT INTO t_glob_temptable1 SELECT i - 1, 'row ' || i FROM generate_series(1, 10) i;
+
+ROLLBACK;
+SELECT count(*) FROM t_glob_temptable1;
+
+-- The rows inserted are not read again by the query
+BEGIN;
+TRUNCATE t_glob_temptable1;
+INSERT INTO t_glob_temptable1 SELECT i, 'row ' || i FROM generate_series(1, 10) i;
+INSERT INTO t_glob_temptable1 SELECT id + 10, lbl FROM t_glob_temptable1;
+SELECT count(*), max(id) FROM t_glob_temptable1;
+
+ROLLBACK;
+SELECT count(*) FROM t_glob_temptable1;
+
+-- Cleanup
+\c - -
+DROP TABLE t_glob_temptable1;
+
+-- CREATE TABLE AS loads the temporary table the same way
+CREATE /*GLOBAL*/ TEMPORARY TABLE t_glob_temptable2 AS SELECT i AS id, 'row ' || i AS lbl FROM generate_series(1, 100) i WITH DATA;
+SELECT count(*) FROM t_glob_temptable2;
+
+SELECT plan_rows('SELECT * FROM t_glob_temptable2');
+
+-- Cleanup
+\c - -
+DROP TABLE t_glob_temptable2;
+DROP FUNCTION plan_rows(text);
@@ -0,0 +1,59 @@
+----
+-- Regression test to Global Temporary Table implementation
+--
+-- Test that COPY FROM and COPY TO use the temporary table and
+-- never the "template" table, even when it does not exist yet.
+--
+----
+
+-- Return the number of rows estimated by the planner
+CREATE FUNCTION plan_rows(query text) RETURNS integer AS $$
+DECLARE
+    plan json;
+BEGIN
+    EXECUTE 'EXPLAIN (FORMAT JSON) ' || query INTO plan;
+    RETURN (plan->0->'Plan'->>'Plan Rows')::float8::integer;
+END
+$$ LANGUAGE plpgsql;
+
+CREATE /*GLOBAL*/ TEMPORARY TABLE t_glob_temptable1 (id integer, lbl text) ON COMMIT PRESERVE ROWS;
+
+-- The first COPY creates the temporary table and loads it
+COPY t_glob_temptable1 FROM stdin;
+1	one
+2	two
+3	three
+\.
+
+SELECT * FROM t_glob_temptable1 ORDER BY id;
+
+SELECT plan_rows('SELECT * FROM t_glob_temptable1');
+
+-- The "template" table must be empty
+SET pgtt.enabled TO off;
+SELECT count(*) FROM pgtt_schema.t_glob_temptable1;
+
+SET pgtt.enabled TO on;
+
+-- A new session sees an empty table
+\c - -
+COPY t_glob_temptable1 TO stdout;
+
+-- Even when the "template" table is named
+COPY pgtt_schema.t_glob_temptable1 FROM stdin;
+4	four
+\.
+
+COPY t_glob_temptable1 TO stdout;
+
+COPY pgtt_schema.t_glob_temptable1 TO stdout;
+
+SET pgtt.enabled TO off;
+SELECT count(*) FROM pgtt_schema.t_glob_temptable1;
+
+SET pgtt.enabled TO on;
+
+-- Cleanup
+\c - -
+DROP TABLE t_glob_temptable1;
+DROP FUNCTION plan_rows(text);
@@ -0,0 +1,63 @@
+----
+-- Regression test to Global Temporary Table implementation
+--
+-- Test the population of a GTT from a SELECT executed with parallel
+-- workers by pgtt_populate().
+--
+----
+
+CREATE TABLE t_source_populate AS SELECT i AS id, 'row ' || i AS lbl FROM generate_series(1, 10000) i;
+ANALYZE t_source_populate;
+
+CREATE /*GLOBAL*/ TEMPORARY TABLE t_glob_temptable1 (id integer NOT NULL, lbl text) ON COMMIT PRESERVE ROWS;
+CREATE INDEX ON t_glob_temptable1 (id);
+
+-- Force the use of parallel workers
+SET parallel_setup_cost TO 0;
+SET parallel_tuple_cost TO 0;
+SET min_parallel_table_scan_size TO 0;
+SET max_parallel_workers_per_gather TO 2;
+
+SELECT pgtt_schema.pgtt_populate('t_glob_temptable1', 'SELECT id, lbl FROM t_source_populate WHERE id % 2 = 0');
+
+SELECT count(*), min(id), max(id) FROM t_glob_temptable1;
+
+-- The index entries are inserted too
+SET enable_seqscan TO off;
+SELECT lbl FROM t_glob_temptable1 WHERE id = 5000;
+
+SET enable_seqscan TO on;
+
+-- The rows are appended
+SELECT pgtt_schema.pgtt_populate('t_glob_temptable1', 'SELECT id, lbl FROM t_source_populate WHERE id % 2 = 1');
+
+SELECT count(*) FROM t_glob_temptable1;
+
+-- The "template" table must be empty
+SET pgtt.enabled TO off;
+SELECT count(*) FROM pgtt_schema.t_glob_temptable1;
+
+SET pgtt.enabled TO on;
+
+-- The columns must match and the constraints are checked
+SELECT pgtt_schema.pgtt_populate('t_glob_temptable1', 'SELECT id, lbl, 1 FROM t_source_populate');
+
+SELECT pgtt_schema.pgtt_populate('t_glob_temptable1', 'SELECT NULL::integer, ''x''');
+
+SELECT pgtt_schema.pgtt_populate('t_glob_temptable1', 'DELETE FROM t_source_populate');
+
+SELECT count(*) FROM t_glob_temptable1;
+
+-- A volatile function reading the table does not see the rows inserted
+CREATE FUNCTION count_temptable1() RETURNS bigint AS $$ SELECT count(*) FROM t_glob_temptable1 $$ LANGUAGE sql VOLATILE;
+BEGIN;
+TRUNCATE t_glob_temptable1;
+SELECT pgtt_schema.pgtt_populate('t_glob_temptable1', 'SELECT i, count_temptable1()::text FROM generate_series(1, 5) i');
+SELECT id, lbl FROM t_glob_temptable1 ORDER BY id;
+ROLLBACK;
+
+-- Cleanup
+\c - -
+DROP TABLE t_glob_temptable1;
+DROP TABLE t_source_populate;
+DROP FUNCTION count_temptable1();
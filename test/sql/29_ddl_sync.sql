@@ -0,0 +1,51 @@
+----
+-- Regression test to Global Temporary Table implementation
+--
+-- Test the changes made on a GTT whose temporary table is in use,
+-- they are applied to the temporary table without reconnecting.
+--
+----
+
+CREATE /*GLOBAL*/ TEMPORARY TABLE t_glob_ddl (id integer, lbl text) ON COMMIT PRESERVE ROWS;
+INSERT INTO t_glob_ddl VALUES (1, 'one');
+
+-- Add a column to the GTT, the temporary table has it too
+ALTER TABLE t_glob_ddl ADD COLUMN c3 integer DEFAULT 3;
+INSERT INTO t_glob_ddl VALUES (2, 'two', 4);
+SELECT * FROM t_glob_ddl ORDER BY id;
+
+-- Rename a column, the rows are kept
+ALTER TABLE t_glob_ddl RENAME COLUMN lbl TO label;
+SELECT id, label FROM t_glob_ddl ORDER BY id;
+
+-- Add a constraint
+ALTER TABLE t_glob_ddl ADD CONSTRAINT t_glob_ddl_c3_check CHECK (c3 > 0);
+INSERT INTO t_glob_ddl VALUES (3, 'three', 0);
+
+-- Add an index and remove it
+CREATE INDEX ON t_glob_ddl (c3);
+SELECT indexname FROM pg_indexes WHERE tablename = 't_glob_ddl' AND schemaname LIKE 'pg_temp_%' ORDER BY indexname;
+
+DROP INDEX pgtt_schema.t_glob_ddl_c3_idx;
+SELECT indexname FROM pg_indexes WHERE tablename = 't_glob_ddl' AND schemaname LIKE 'pg_temp_%' ORDER BY indexname;
+
+-- Rename the GTT
+ALTER TABLE t_glob_ddl RENAME TO t_glob_ddl2;
+SELECT * FROM t_glob_ddl2 ORDER BY id;
+
+-- The "template" table has the same definition
+SELECT attname FROM pg_attribute WHERE attrelid = 'pgtt_schema.t_glob_ddl2'::regclass AND attnum > 0 AND NOT attisdropped ORDER BY attnum;
+
+-- A change that can not be applied is tried again once the table is empty
+SET client_min_messages TO error;
+ALTER TABLE t_glob_ddl2 ADD COLUMN c4 integer NOT NULL;
+SELECT count(*) FROM t_glob_ddl2;
+SELECT attname FROM pg_attribute a JOIN pg_class c ON (c.oid = a.attrelid) JOIN pg_namespace n ON (n.oid = c.relnamespace) WHERE c.relname = 't_glob_ddl2' AND n.nspname LIKE 'pg_temp%' AND a.attnum > 0 AND NOT a.attisdropped ORDER BY a.attnum;
+TRUNCATE t_glob_ddl2;
+SELECT count(*) FROM t_glob_ddl2;
+RESET client_min_messages;
+SELECT attname FROM pg_attribute a JOIN pg_class c ON (c.oid = a.attrelid) JOIN pg_namespace n ON (n.oid = c.relnamespace) WHERE c.relname = 't_glob_ddl2' AND n.nspname LIKE 'pg_temp%' AND a.attnum > 0 AND NOT a.attisdropped ORDER BY a.attnum;
+
+-- Cleanup
+\c - -
+DROP TABLE t_glob_ddl2;
@@ -0,0 +1,58 @@
+----
+-- Regression test to Global Temporary Table implementation
+--
+-- Test the storage parameters of a GTT, they are used by its temporary
+-- table, and the options of the GTT stored in the registry.
+--
+----
+
+-- Return the number of rows estimated by the planner
+CREATE FUNCTION plan_rows(query text) RETURNS integer AS $$
+DECLARE
+    plan json;
+BEGIN
+    EXECUTE 'EXPLAIN (FORMAT JSON) ' || query INTO plan;
+    RETURN (plan->0->'Plan'->>'Plan Rows')::float8::integer;
+END
+$$ LANGUAGE plpgsql;
+
+CREATE /*GLOBAL*/ TEMPORARY TABLE t_glob_storage (id integer, lbl text) WITH (fillfactor = 70) ON COMMIT PRESERVE ROWS;
+ALTER TABLE pgtt_schema.t_glob_storage ALTER COLUMN lbl SET STORAGE EXTERNAL;
+INSERT INTO t_glob_storage VALUES (1, 'one');
+
+-- The temporary table has the storage parameters of the "template" table
+SELECT regexp_replace(n.nspname, '\d+', 'x', 'g') AS nspname, c.reloptions FROM pg_class c JOIN pg_namespace n ON (c.relnamespace=n.oid) WHERE c.relname = 't_glob_storage' ORDER BY c.relpersistence;
+
+SELECT attname, attstorage FROM pg_attribute WHERE attrelid = 'pg_temp.t_glob_storage'::regclass AND attnum > 0 ORDER BY attnum;
+
+-- The changes are applied to the temporary table in use
+ALTER TABLE t_glob_storage SET (toast_tuple_target = 256);
+ALTER TABLE t_glob_storage RESET (fillfactor);
+ALTER TABLE t_glob_storage ALTER COLUMN lbl SET STORAGE MAIN;
+SELECT regexp_replace(n.nspname, '\d+', 'x', 'g') AS nspname, c.reloptions FROM pg_class c JOIN pg_namespace n ON (c.relnamespace=n.oid) WHERE c.relname = 't_glob_storage' ORDER BY c.relpersistence;
+
+SELECT attname, attstorage FROM pg_attribute WHERE attrelid = 'pg_temp.t_glob_storage'::regclass AND attnum > 0 ORDER BY attnum;
+
+-- Options of the GTT stored in the registry
+SELECT pgtt_schema.pgtt_set_option('t_glob_storage', 'expected_rows', '5000');
+
+SELECT relname, options FROM pgtt_schema.pg_global_temp_tables WHERE relname = 't_glob_storage';
+
+SELECT pgtt_schema.pgtt_set_option('t_glob_storage', 'expected_rows', 'many');
+
+SELECT pgtt_schema.pgtt_set_option('t_glob_storage', 'unknown', '1');
+
+-- The planner uses the expected number of rows when it does not know it
+SET pgtt.exact_row_counts TO off;
+SELECT plan_rows('SELECT * FROM t_glob_storage');
+
+SELECT pgtt_schema.pgtt_set_option('t_glob_storage', 'expected_rows', NULL);
+
+SELECT relname, options FROM pgtt_schema.pg_global_temp_tables WHERE relname = 't_glob_storage';
+
+SET pgtt.exact_row_counts TO on;
+
+-- Cleanup
+\c - -
+DROP TABLE t_glob_storage;
+DROP FUNCTION plan_rows(text);
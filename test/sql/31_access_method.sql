@@ -0,0 +1,33 @@
+----
+-- Regression test to Global Temporary Table implementation
+--
+-- Test the table access method of the temporary tables of a GTT.
+--
+----
+
+CREATE ACCESS METHOD heap2 TYPE TABLE HANDLER heap_tableam_handler;
+
+CREATE /*GLOBAL*/ TEMPORARY TABLE t_glob_am (id integer, lbl text) USING heap2 ON COMMIT PRESERVE ROWS;
+
+-- The access method is recorded in the registry
+SELECT relname, options FROM pgtt_schema.pg_global_temp_tables WHERE relname = 't_glob_am';
+
+INSERT INTO t_glob_am VALUES (1, 'one');
+SELECT * FROM t_glob_am;
+
+-- Only the temporary table uses it
+SELECT regexp_replace(n.nspname, '\d+', 'x', 'g') AS nspname, a.amname FROM pg_class c JOIN pg_namespace n ON (c.relnamespace=n.oid) JOIN pg_am a ON (a.oid = c.relam) WHERE c.relname = 't_glob_am' ORDER BY c.relpersistence;
+
+SELECT pgtt_schema.pgtt_set_option('t_glob_am', 'access_method', 'nope');
+
+-- The new sessions use the default access method
+SELECT pgtt_schema.pgtt_set_option('t_glob_am', 'access_method', NULL);
+
+\c - -
+INSERT INTO t_glob_am VALUES (2, 'two');
+SELECT regexp_replace(n.nspname, '\d+', 'x', 'g') AS nspname, a.amname FROM pg_class c JOIN pg_namespace n ON (c.relnamespace=n.oid) JOIN pg_am a ON (a.oid = c.relam) WHERE c.relname = 't_glob_am' ORDER BY c.relpersistence;
+
+-- Cleanup
+\c - -
+DROP TABLE t_glob_am;
+DROP ACCESS METHOD heap2;
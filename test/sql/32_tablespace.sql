@@ -0,0 +1,26 @@
+----
+-- Regression test to Global Temporary Table implementation
+--
+-- Test the tablespace of the temporary tables of a GTT.
+--
+----
+
+CREATE /*GLOBAL*/ TEMPORARY TABLE t_glob_spc (id integer PRIMARY KEY, lbl text) ON COMMIT PRESERVE ROWS TABLESPACE pg_default;
+
+-- The tablespace is recorded in the registry
+SELECT relname, options FROM pgtt_schema.pg_global_temp_tables WHERE relname = 't_glob_spc';
+
+SELECT pgtt_schema.pgtt_set_option('t_glob_spc', 'tablespace', 'nope');
+
+SELECT pgtt_schema.pgtt_set_option('t_glob_spc', 'tablespace', 'pg_global');
+
+-- A tablespace that does not exist any more is skipped
+UPDATE pgtt_schema.pg_global_temp_tables SET options = '{"tablespace=dropped_spc, pg_default"}' WHERE relname = 't_glob_spc';
+INSERT INTO t_glob_spc VALUES (1, 'one');
+SELECT c.relname, c.reltablespace FROM pg_class c JOIN pg_namespace n ON (c.relnamespace=n.oid) WHERE n.nspname LIKE 'pg_temp%' AND c.relname LIKE 't_glob_spc%' ORDER BY c.relname;
+
+SELECT * FROM t_glob_spc;
+
+-- Cleanup
+\c - -
+DROP TABLE t_glob_spc;
@@ -0,0 +1,40 @@
+----
+-- Regression test to Global Temporary Table implementation
+--
+-- Test partitioned Global Temporary Tables.
+--
+----
+
+CREATE /*GLOBAL*/ TEMPORARY TABLE t_glob_part (id integer, lbl text) PARTITION BY RANGE (id) ON COMMIT PRESERVE ROWS;
+CREATE /*GLOBAL*/ TEMPORARY TABLE t_glob_part_1 PARTITION OF t_glob_part FOR VALUES FROM (1) TO (100);
+CREATE /*GLOBAL*/ TEMPORARY TABLE t_glob_part_2 PARTITION OF t_glob_part FOR VALUES FROM (100) TO (200);
+
+-- The parent of a partition must be a GTT
+CREATE TABLE t_not_glob (id integer) PARTITION BY RANGE (id);
+CREATE /*GLOBAL*/ TEMPORARY TABLE t_glob_bad PARTITION OF t_not_glob FOR VALUES FROM (1) TO (100);
+
+DROP TABLE t_not_glob;
+
+-- The partitions are registered as GTT and inherit the ON COMMIT clause
+SELECT relname, preserved FROM pgtt_schema.pg_global_temp_tables WHERE relname LIKE 't_glob_part%' ORDER BY relname;
+
+SELECT c.relname, c.relkind, c.relpersistence FROM pg_class c JOIN pg_namespace n ON (c.relnamespace=n.oid) WHERE n.nspname = 'pgtt_schema' AND c.relname LIKE 't_glob_part%' ORDER BY c.relname;
+
+-- The whole partition tree is created at first access
+INSERT INTO t_glob_part VALUES (1, 'one'), (150, 'two');
+SELECT c.relname, c.relkind, c.relispartition FROM pg_class c JOIN pg_namespace n ON (c.relnamespace=n.oid) WHERE n.nspname LIKE 'pg_temp%' AND c.relname LIKE 't_glob_part%' ORDER BY c.relname;
+
+SELECT tableoid::regclass, * FROM t_glob_part ORDER BY id;
+
+SELECT * FROM t_glob_part_2;
+
+-- Nothing is stored in the "template" tables
+SET pgtt.enabled TO off;
+SELECT count(*) FROM pgtt_schema.t_glob_part;
+
+SET pgtt.enabled TO on;
+
+-- Cleanup, the partitions are dropped with their parent
+\c - -
+DROP TABLE t_glob_part;
+SELECT count(*) FROM pgtt_schema.pg_global_temp_tables WHERE relname LIKE 't_glob_part%';
@@ -0,0 +1,42 @@
+----
+-- Regression test to Global Temporary Table implementation
+--
+-- Test the session-local counters of the serial and identity columns.
+--
+----
+
+SET pgtt.session_sequences TO on;
+CREATE /*GLOBAL*/ TEMPORARY TABLE t_glob_seq (id serial, lbl text) ON COMMIT PRESERVE ROWS;
+CREATE /*GLOBAL*/ TEMPORARY TABLE t_glob_ident (id bigint GENERATED ALWAYS AS IDENTITY (START WITH 10 INCREMENT BY 5), lbl text) ON COMMIT PRESERVE ROWS;
+
+INSERT INTO t_glob_seq (lbl) VALUES ('a'), ('b');
+INSERT INTO t_glob_ident (lbl) VALUES ('a'), ('b');
+SELECT * FROM t_glob_seq ORDER BY id;
+
+SELECT * FROM t_glob_ident ORDER BY id;
+
+-- The shared sequence is not used and no temporary sequence is created
+SELECT last_value, is_called FROM pgtt_schema.t_glob_seq_id_seq;
+
+SELECT count(*) FROM pg_class c JOIN pg_namespace n ON (c.relnamespace=n.oid) WHERE n.nspname LIKE 'pg_temp%' AND c.relkind = 'S';
+
+-- Each session has its own counters
+\c - -
+SET pgtt.session_sequences TO on;
+INSERT INTO t_glob_seq (lbl) VALUES ('c');
+INSERT INTO t_glob_ident (lbl) VALUES ('c');
+SELECT * FROM t_glob_seq ORDER BY id;
+
+SELECT * FROM t_glob_ident ORDER BY id;
+
+-- When disabled (default) the shared sequence is used
+\c - -
+INSERT INTO t_glob_seq (lbl) VALUES ('d');
+SELECT * FROM t_glob_seq ORDER BY id;
+
+SELECT last_value, is_called FROM pgtt_schema.t_glob_seq_id_seq;
+
+-- Cleanup
+\c - -
+DROP TABLE t_glob_seq;
+DROP TABLE t_glob_ident;
@@ -0,0 +1,25 @@
+----
+-- Regression test to Global Temporary Table implementation
+--
+-- Test the lean profile of the temporary tables.
+--
+----
+
+CREATE /*GLOBAL*/ TEMPORARY TABLE t_glob_lean (id integer, lbl text) ON COMMIT PRESERVE ROWS;
+COMMENT ON COLUMN t_glob_lean.lbl IS 'label of the row';
+
+SET pgtt.lean_instantiation TO on;
+SELECT * FROM t_glob_lean;
+
+-- No comment and no TOAST table on the temporary table
+SELECT col_description(c.oid, 2) IS NULL AS no_comment, c.reltoastrelid = 0 AS no_toast FROM pg_class c JOIN pg_namespace n ON (c.relnamespace=n.oid) WHERE n.nspname LIKE 'pg_temp%' AND c.relname = 't_glob_lean';
+
+-- The TOAST table is created by the first write
+INSERT INTO t_glob_lean SELECT 1, string_agg(md5(i::text), '') FROM generate_series(1, 1000) i;
+SELECT c.reltoastrelid <> 0 AS has_toast FROM pg_class c JOIN pg_namespace n ON (c.relnamespace=n.oid) WHERE n.nspname LIKE 'pg_temp%' AND c.relname = 't_glob_lean';
+
+SELECT id, length(lbl) FROM t_glob_lean;
+
+-- Cleanup
+\c - -
+DROP TABLE t_glob_lean;
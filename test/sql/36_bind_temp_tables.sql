@@ -0,0 +1,58 @@
+----
+-- Regression test to Global Temporary Table implementation
+--
+-- Test the use of a GTT by CREATE TEMPORARY TABLE and DROP TABLE.
+--
+----
+
+CREATE /*GLOBAL*/ TEMPORARY TABLE t_glob_bind (id integer, lbl text) ON COMMIT PRESERVE ROWS;
+
+SET pgtt.bind_temp_tables TO on;
+CREATE TEMPORARY TABLE t_glob_bind (id integer, lbl text);
+INSERT INTO t_glob_bind VALUES (1, 'one');
+SELECT * FROM t_glob_bind;
+
+CREATE TEMPORARY TABLE t_glob_bind (id integer, lbl text);
+
+CREATE TEMPORARY TABLE IF NOT EXISTS t_glob_bind (id integer, lbl text);
+
+-- DROP TABLE only empties the temporary table, the GTT is kept
+DROP TABLE t_glob_bind;
+SELECT count(*) FROM pgtt_schema.pg_global_temp_tables WHERE relname = 't_glob_bind';
+
+DROP TABLE t_glob_bind;
+
+DROP TABLE IF EXISTS t_glob_bind;
+
+CREATE TEMPORARY TABLE t_glob_bind (id integer, lbl text);
+SELECT * FROM t_glob_bind;
+
+SELECT count(*) FROM pg_class c JOIN pg_namespace n ON (c.relnamespace=n.oid) WHERE n.nspname LIKE 'pg_temp%' AND c.relname = 't_glob_bind';
+
+-- A DROP TABLE rolled back leaves the table
+BEGIN;
+DROP TABLE t_glob_bind;
+ROLLBACK;
+CREATE TEMPORARY TABLE t_glob_bind (id integer, lbl text);
+
+-- Same with a DROP TABLE rolled back to a savepoint
+BEGIN;
+SAVEPOINT sp1;
+DROP TABLE t_glob_bind;
+ROLLBACK TO SAVEPOINT sp1;
+CREATE TEMPORARY TABLE t_glob_bind (id integer, lbl text);
+ROLLBACK;
+
+-- A local temporary table that does not match its GTT can be dropped
+CREATE /*GLOBAL*/ TEMPORARY TABLE t_glob_bind2 (id integer, lbl text) ON COMMIT PRESERVE ROWS;
+CREATE TEMPORARY TABLE t_glob_bind2 (id integer);
+DROP TABLE t_glob_bind2;
+CREATE TEMPORARY TABLE t_glob_bind2 (id integer);
+DROP TABLE pg_temp.t_glob_bind2;
+SELECT count(*) FROM pg_class c JOIN pg_namespace n ON (c.relnamespace=n.oid) WHERE n.nspname LIKE 'pg_temp%' AND c.relname = 't_glob_bind2';
+SELECT count(*) FROM pgtt_schema.pg_global_temp_tables WHERE relname = 't_glob_bind2';
+
+-- Cleanup
+\c - -
+DROP TABLE t_glob_bind;
+DROP TABLE t_glob_bind2;
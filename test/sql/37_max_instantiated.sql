@@ -0,0 +1,60 @@
+----
+-- Regression test to Global Temporary Table implementation
+--
+-- Test the limit of temporary tables of GTT in a session.
+--
+----
+
+CREATE /*GLOBAL*/ TEMPORARY TABLE t_glob_lru1 (id integer) ON COMMIT DELETE ROWS;
+CREATE /*GLOBAL*/ TEMPORARY TABLE t_glob_lru2 (id integer) ON COMMIT DELETE ROWS;
+CREATE /*GLOBAL*/ TEMPORARY TABLE t_glob_lru3 (id integer) ON COMMIT PRESERVE ROWS;
+
+SET pgtt.max_instantiated TO 1;
+SELECT * FROM t_glob_lru1;
+
+-- The temporary table of t_glob_lru1 is empty, it is dropped
+SELECT * FROM t_glob_lru2;
+
+SELECT c.relname FROM pg_class c JOIN pg_namespace n ON (c.relnamespace=n.oid) WHERE n.nspname LIKE 'pg_temp%' AND c.relname LIKE 't_glob_lru%' ORDER BY 1;
+
+-- Both tables are used in the same transaction, none is dropped
+BEGIN;
+SELECT * FROM t_glob_lru2;
+
+INSERT INTO t_glob_lru1 VALUES (1);
+
+SELECT c.relname FROM pg_class c JOIN pg_namespace n ON (c.relnamespace=n.oid) WHERE n.nspname LIKE 'pg_temp%' AND c.relname LIKE 't_glob_lru%' ORDER BY 1;
+
+COMMIT;
+
+-- A table with rows is kept
+INSERT INTO t_glob_lru3 VALUES (1);
+SELECT * FROM t_glob_lru1;
+
+SELECT c.relname FROM pg_class c JOIN pg_namespace n ON (c.relnamespace=n.oid) WHERE n.nspname LIKE 'pg_temp%' AND c.relname LIKE 't_glob_lru%' ORDER BY 1;
+
+-- An eviction rolled back keeps the temporary table
+BEGIN;
+SELECT * FROM t_glob_lru2;
+
+ROLLBACK;
+SELECT c.relname FROM pg_class c JOIN pg_namespace n ON (c.relnamespace=n.oid) WHERE n.nspname LIKE 'pg_temp%' AND c.relname LIKE 't_glob_lru%' ORDER BY 1;
+
+SELECT * FROM t_glob_lru1;
+
+-- An eviction rolled back to a savepoint keeps the temporary table
+BEGIN;
+SAVEPOINT sp1;
+SELECT * FROM t_glob_lru2;
+
+ROLLBACK TO SAVEPOINT sp1;
+SELECT * FROM t_glob_lru1;
+
+COMMIT;
+SELECT c.relname FROM pg_class c JOIN pg_namespace n ON (c.relnamespace=n.oid) WHERE n.nspname LIKE 'pg_temp%' AND c.relname LIKE 't_glob_lru%' ORDER BY 1;
+
+-- Cleanup
+\c - -
+DROP TABLE t_glob_lru1;
+DROP TABLE t_glob_lru2;
+DROP TABLE t_glob_lru3;
@@ -0,0 +1,33 @@
+----
+-- Regression test to Global Temporary Table implementation
+--
+-- Test the local buffers budget of a GTT.
+--
+----
+
+CREATE /*GLOBAL*/ TEMPORARY TABLE t_glob_budget (id integer, lbl text) ON COMMIT PRESERVE ROWS;
+
+SELECT pgtt_schema.pgtt_set_option('t_glob_budget', 'buffer_budget', 'many');
+
+SELECT pgtt_schema.pgtt_set_option('t_glob_budget', 'buffer_budget', '8kB');
+
+SELECT pgtt_schema.pgtt_local_buffers('t_glob_budget');
+
+INSERT INTO t_glob_budget SELECT i, 'line ' || i FROM generate_series(1, 1000) i;
+SELECT pgtt_schema.pgtt_local_buffers('t_glob_budget') > 1;
+
+-- The local buffers of the emptied table do not hold a block anymore
+TRUNCATE t_glob_budget;
+SELECT pgtt_schema.pgtt_local_buffers('t_glob_budget');
+
+SELECT count(*) FROM t_glob_budget;
+
+SELECT pgtt_schema.pgtt_release_local_buffers() >= 0;
+
+-- The released buffers can be used again
+INSERT INTO t_glob_budget SELECT i, 'line ' || i FROM generate_series(1, 1000) i;
+SELECT count(*), sum(id) FROM t_glob_budget;
+
+-- Cleanup
+\c - -
+DROP TABLE t_glob_budget;
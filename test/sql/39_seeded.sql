@@ -0,0 +1,59 @@
+----
+-- Regression test to Global Temporary Table implementation
+--
+-- Test the GTT whose "template" table holds the initial rows.
+--
+----
+
+CREATE /*GLOBAL*/ TEMPORARY TABLE t_glob_seed (id integer, lbl text) ON COMMIT PRESERVE ROWS;
+
+SELECT pgtt_schema.pgtt_set_option('t_glob_seed', 'seeded', 'maybe');
+
+SELECT pgtt_schema.pgtt_set_option('t_glob_seed', 'seeded', 'true');
+
+-- The "template" holding the rows is logged
+SELECT relpersistence FROM pg_class WHERE oid = 'pgtt_schema.t_glob_seed'::regclass;
+
+-- The rows are inserted into the "template" table with pgtt disabled
+SET pgtt.enabled TO off;
+INSERT INTO pgtt_schema.t_glob_seed VALUES (1, 'one'), (2, 'two');
+SET pgtt.enabled TO on;
+
+-- They are read from the "template", no temporary table is created
+SELECT * FROM t_glob_seed ORDER BY id;
+
+SELECT count(*) FROM pg_class c JOIN pg_namespace n ON (c.relnamespace=n.oid) WHERE n.nspname LIKE 'pg_temp%' AND c.relname = 't_glob_seed';
+
+-- The first write creates the temporary table with a copy of the rows
+INSERT INTO t_glob_seed VALUES (3, 'three');
+DELETE FROM t_glob_seed WHERE id = 1;
+SELECT * FROM t_glob_seed ORDER BY id;
+
+SELECT count(*) FROM pg_class c JOIN pg_namespace n ON (c.relnamespace=n.oid) WHERE n.nspname LIKE 'pg_temp%' AND c.relname = 't_glob_seed';
+
+-- The "template" is unchanged
+SET pgtt.enabled TO off;
+SELECT * FROM pgtt_schema.t_glob_seed ORDER BY id;
+
+SET pgtt.enabled TO on;
+
+-- A new session starts with the rows of the "template"
+\c - -
+SELECT * FROM t_glob_seed ORDER BY id;
+
+-- TRUNCATE only empties the temporary table
+TRUNCATE t_glob_seed;
+SELECT count(*) FROM t_glob_seed;
+
+SET pgtt.enabled TO off;
+SELECT count(*) FROM pgtt_schema.t_glob_seed;
+
+SET pgtt.enabled TO on;
+
+-- The "template" is unlogged again without the option
+SELECT pgtt_schema.pgtt_set_option('t_glob_seed', 'seeded', NULL);
+SELECT relpersistence FROM pg_class WHERE oid = 'pgtt_schema.t_glob_seed'::regclass;
+
+-- Cleanup
+\c - -
+DROP TABLE t_glob_seed;
@@ -0,0 +1,86 @@
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "ALTER EXTENSION pgtt UPDATE" to load this file. \quit
+
+----
+-- Store on the "template" table the statistics of the temporary table
+-- of a GTT in the current session. The temporary tables created later
+-- are seeded with these statistics. Reserved to the owner of the GTT.
+----
+CREATE FUNCTION @extschema@.pgtt_capture_statistics(regclass)
+RETURNS integer
+AS 'MODULE_PATHNAME', 'pgtt_capture_statistics'
+LANGUAGE C STRICT VOLATILE;
+
+----
+-- Fill the temporary table of a GTT with the rows returned by a SELECT
+-- executed with parallel workers when possible. Returns the number of
+-- rows inserted.
+----
+CREATE FUNCTION @extschema@.pgtt_populate(regclass, text)
+RETURNS bigint
+AS 'MODULE_PATHNAME', 'pgtt_populate'
+LANGUAGE C STRICT VOLATILE;
+
+----
+-- Statistics of the temporary tables of the GTT shared between sessions
+-- when pgtt.learn_statistics is enabled: moving averages of the number
+-- of rows and pages and of the width and number of distinct values of
+-- each column of the "template" table found by ANALYZE. Sessions write
+-- to this table as its owner, they only need to read it.
+----
+CREATE TABLE @extschema@.pg_global_temp_stats (
+	relid oid NOT NULL,
+	samples bigint NOT NULL,
+	tuples float8 NOT NULL,
+	pages float8 NOT NULL,
+	widths integer[],
+	ndistinct real[],
+	last_update timestamp with time zone,
+	UNIQUE (relid)
+);
+REVOKE ALL ON TABLE @extschema@.pg_global_temp_stats FROM PUBLIC;
+GRANT SELECT ON TABLE @extschema@.pg_global_temp_stats TO PUBLIC;
+-- The row of a GTT is created with it, the sessions only update it
+INSERT INTO @extschema@.pg_global_temp_stats (relid, samples, tuples, pages)
+	SELECT relid, 0, 0, 0 FROM @extschema@.pg_global_temp_tables;
+
+----
+-- Options of the GTT, as name=value, see pgtt_set_option()
+----
+ALTER TABLE @extschema@.pg_global_temp_tables ADD COLUMN options text[];
+
+----
+-- Set an option of a GTT stored in the registry, a NULL value removes
+-- it. The options are applied to the temporary tables created later and
+-- at once to the temporary table of the current session. Reserved to the
+-- owner of the GTT.
+----
+CREATE FUNCTION @extschema@.pgtt_set_option(regclass, text, text)
+RETURNS void
+AS 'MODULE_PATHNAME', 'pgtt_set_option'
+LANGUAGE C VOLATILE;
+
+----
+-- Next value of a counter private to the session that replaces the
+-- sequence of a serial or identity column in the temporary tables of
+-- the GTT, see pgtt.session_sequences.
+----
+CREATE FUNCTION @extschema@.pgtt_nextval(regclass)
+RETURNS bigint
+AS 'MODULE_PATHNAME', 'pgtt_nextval'
+LANGUAGE C STRICT VOLATILE;
+
+----
+-- Number of local buffers of the session holding a block of the
+-- temporary table of a GTT, and release of the memory of the local
+-- buffers that do not hold a block, see pgtt.buffer_budget.
+----
+CREATE FUNCTION @extschema@.pgtt_local_buffers(regclass)
+RETURNS bigint
+AS 'MODULE_PATHNAME', 'pgtt_local_buffers'
+LANGUAGE C STRICT VOLATILE;
+
+CREATE FUNCTION @extschema@.pgtt_release_local_buffers()
+RETURNS bigint
+AS 'MODULE_PATHNAME', 'pgtt_release_local_buffers'
+LANGUAGE C STRICT VOLATILE;